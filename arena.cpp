@@ -0,0 +1,121 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+static_assert(is_trivially_destructible<GameState>::value && is_trivially_destructible<BotPlan>::value,
+              "The arena frees its arrays without running destructors");
+
+
+/**
+ * @brief Derives the seed of one game of an arena.
+ *
+ * @param seed The arena's seed.
+ * @param index The game's seat.
+ * @param round The number of games the seat has finished.
+ */
+uint64_t arenaGameSeed(uint64_t seed, int index, uint32_t round) {
+    return mixBits(seed ^ (uint64_t(index) << 32 | round));
+}
+
+/**
+ * @brief Starts count games, all played by the bot.
+ *
+ * The bots search single-threaded, since the pool passed to step() runs
+ * the chunks in parallel instead, and without a transposition table,
+ * which would cost megabytes per chunk.
+ *
+ * @param count The number of games.
+ * @param seed Seeds every game; the same seed gives the same games.
+ * @param rules The rules every game is played by.
+ * @param config The bot's search settings.
+ */
+GameArena::GameArena(int count, uint64_t seed, const GameRules& rules, const BotConfig& config)
+    : games(count), baseSeed(seed), gameRules(rules) {
+    // Lay the arrays out back to back, each starting on a cache line
+    auto reserve = [&](size_t size) {
+        size_t offset = memoryBytes;
+        memoryBytes += (size * size_t(games) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+        return offset;
+    };
+    size_t statesOffset = reserve(sizeof(GameState));
+    size_t plansOffset = reserve(sizeof(BotPlan));
+    size_t finishedOffset = reserve(sizeof(uint32_t));
+    size_t bestScoresOffset = reserve(sizeof(int));
+    memory = ::operator new(memoryBytes, align_val_t(ARENA_ALIGNMENT));
+    char* base = static_cast<char*>(memory);
+    states = reinterpret_cast<GameState*>(base + statesOffset);
+    plans = reinterpret_cast<BotPlan*>(base + plansOffset);
+    finished = reinterpret_cast<uint32_t*>(base + finishedOffset);
+    bestScores = reinterpret_cast<int*>(base + bestScoresOffset);
+
+    for (int i = 0; i < games; i++) {
+        new (&states[i]) GameState();
+        finished[i] = 0;
+        bestScores[i] = 0;
+        startGame(i);
+    }
+
+    BotConfig chunkConfig = config;
+    chunkConfig.threads = 1;
+    chunkConfig.tableMegabytes = 0;
+    for (int chunk = 0; chunk * ARENA_CHUNK_SIZE < games; chunk++) {
+        bots.emplace_back(new Bot(chunkConfig));
+    }
+}
+
+GameArena::~GameArena() {
+    ::operator delete(memory, align_val_t(ARENA_ALIGNMENT));
+}
+
+/**
+ * @brief Advances every game.
+ *
+ * @param pool The threads to step the chunks on.
+ * @param ticks The ticks to advance each game by.
+ */
+void GameArena::step(WorkStealingPool& pool, int ticks) {
+    TaskGroup group;
+    for (int chunk = 0; chunk < int(bots.size()); chunk++) {
+        pool.submit(group, [this, chunk, ticks] { stepChunk(chunk, ticks); });
+    }
+    pool.wait(group);
+}
+
+/**
+ * @brief The arena's memory divided by its games: the per-game arrays and
+ * each game's share of the bots.
+ */
+size_t GameArena::bytesPerGame() const {
+    return (memoryBytes + bots.size() * sizeof(Bot)) / size_t(max(games, 1));
+}
+
+/**
+ * @brief Steps the games of one chunk, one game at a time for all ticks
+ * so each game stays in cache while it runs.
+ */
+void GameArena::stepChunk(int chunk, int ticks) {
+    Bot& bot = *bots[chunk];
+    int end = min(games, (chunk + 1) * ARENA_CHUNK_SIZE);
+    for (int i = chunk * ARENA_CHUNK_SIZE; i < end; i++) {
+        GameState& state = states[i];
+        for (int tick = 0; tick < ticks; tick++) {
+            if (state.gameOver) {
+                bestScores[i] = max(bestScores[i], state.score);
+                finished[i]++;
+                startGame(i);
+            }
+            state.step(bot.nextInput(state, plans[i]));
+        }
+    }
+}
+
+void GameArena::startGame(int index) {
+    GameState& state = states[index];
+    state.rules = gameRules;
+    state.reset(arenaGameSeed(baseSeed, index, finished[index]));
+    new (&plans[index]) BotPlan();
+}
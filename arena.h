@@ -0,0 +1,70 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "bot.h"
+#include "game.h"
+#include "thread_pool.h"
+
+// Games stepped by one pool task; each chunk of games shares one bot
+const int ARENA_CHUNK_SIZE = 16;
+// Alignment of each per-game array, a cache line
+const size_t ARENA_ALIGNMENT = 64;
+
+/**
+ * @brief Many concurrent bot games, for tournaments and spectator walls.
+ *
+ * The games are stored as a struct of arrays: each per-game component
+ * has its own array, and all the arrays are carved from one cache-line
+ * aligned allocation. The components are the games themselves (a
+ * GameState is flat, board included, so it owns no memory), the plans of
+ * the bots steering them, and each seat's finished game count and best
+ * score. A game that tops out records its score and starts over with a
+ * fresh seed, so there are always count() games in play.
+ *
+ * step() advances the games in chunks of ARENA_CHUNK_SIZE across a thread
+ * pool. A chunk is only ever stepped by one task at a time, so the bot it
+ * owns needs no locking, and every game depends only on its own seed, so
+ * the results do not depend on the thread count.
+ */
+class GameArena {
+public:
+    GameArena(int count, uint64_t seed, const GameRules& rules, const BotConfig& config);
+    ~GameArena();
+
+    GameArena(const GameArena&) = delete;
+    GameArena& operator=(const GameArena&) = delete;
+
+    void step(WorkStealingPool& pool, int ticks = 1);
+
+    int count() const { return games; }
+    const GameState& game(int index) const { return states[index]; }
+    uint32_t finishedCount(int index) const { return finished[index]; }
+    int bestScore(int index) const { return bestScores[index]; }
+    size_t bytesPerGame() const;
+
+private:
+    void stepChunk(int chunk, int ticks);
+    void startGame(int index);
+
+    int games;
+    uint64_t baseSeed;
+    GameRules gameRules;
+
+    // One allocation holding the per-game arrays below
+    void* memory = NULL;
+    size_t memoryBytes = 0;
+    GameState* states = NULL;
+    BotPlan* plans = NULL;
+    uint32_t* finished = NULL; // games finished in each seat
+    int* bestScores = NULL;
+
+    std::vector<std::unique_ptr<Bot>> bots; // one per chunk
+};
+
+uint64_t arenaGameSeed(uint64_t seed, int index, uint32_t round);
+
+#endif // ARENA_H
@@ -0,0 +1,69 @@
+#include "block_batch.h"
+
+#include <iostream>
+
+using namespace std;
+
+
+BlockBatch::BlockBatch(SDL_Renderer* renderer, int tileSize)
+    : renderer(renderer) {
+    // Black outline around a white face; the vertex color tints the face.
+    // Tiles too small for the outline to leave much face are all face.
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, tileSize, tileSize, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface != NULL) {
+        int border = tileSize >= MIN_OUTLINED_TILE_SIZE ? 1 : 0;
+        SDL_Rect face = { border, border, tileSize - 2 * border, tileSize - 2 * border };
+        SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 0, 0, 0, 255));
+        SDL_FillRect(surface, &face, SDL_MapRGBA(surface->format, 255, 255, 255, 255));
+        tile = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_FreeSurface(surface);
+    }
+    if (tile == NULL) {
+        cout << "Failed to create block tile! SDL_Error: " << SDL_GetError() << endl;
+        return;
+    }
+    SDL_SetTextureBlendMode(tile, SDL_BLENDMODE_BLEND);
+}
+
+BlockBatch::~BlockBatch() {
+    if (tile != NULL) {
+        SDL_DestroyTexture(tile);
+    }
+}
+
+/**
+ * @brief Queues one block.
+ *
+ * @param x The x-coordinate of the block's top-left corner.
+ * @param y The y-coordinate of the block's top-left corner.
+ * @param size The width and height of the block.
+ * @param color The color of the block face.
+ */
+void BlockBatch::addBlock(int x, int y, int size, SDL_Color color) {
+    int base = int(vertices.size());
+    float left = float(x), top = float(y), right = float(x + size), bottom = float(y + size);
+    vertices.push_back({ { left, top }, color, { 0, 0 } });
+    vertices.push_back({ { right, top }, color, { 1, 0 } });
+    vertices.push_back({ { right, bottom }, color, { 1, 1 } });
+    vertices.push_back({ { left, bottom }, color, { 0, 1 } });
+    int quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+    indices.insert(indices.end(), quad, quad + 6);
+}
+
+/**
+ * @brief Draws every queued block with a single call and empties the batch.
+ *
+ * The vertex and index buffers keep their capacity, so steady-state
+ * frames do not allocate.
+ *
+ * @param stats Receives the draw call and vertex counts.
+ */
+void BlockBatch::flush(RenderStats& stats) {
+    if (!vertices.empty() && tile != NULL) {
+        SDL_RenderGeometry(renderer, tile, vertices.data(), int(vertices.size()), indices.data(), int(indices.size()));
+        stats.drawCalls++;
+        stats.vertices += int(vertices.size());
+    }
+    vertices.clear();
+    indices.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef BLOCK_BATCH_H
+#define BLOCK_BATCH_H
+
+#include <SDL.h>
+#include <vector>
+
+// Smallest tile drawn with an outline around its face
+const int MIN_OUTLINED_TILE_SIZE = 6;
+
+// Draw work submitted for one frame
+struct RenderStats {
+    int drawCalls = 0;
+    int vertices = 0;
+};
+
+/**
+ * @brief Collects blocks for a frame and draws them with one call.
+ *
+ * Every block is a textured quad over a prebuilt tile (black outline,
+ * white face) tinted by the vertex color, so the whole batch goes to the
+ * GPU in a single SDL_RenderGeometry call regardless of how many blocks
+ * or colors it holds.
+ */
+class BlockBatch {
+public:
+    BlockBatch(SDL_Renderer* renderer, int tileSize);
+    ~BlockBatch();
+
+    BlockBatch(const BlockBatch&) = delete;
+    BlockBatch& operator=(const BlockBatch&) = delete;
+
+    bool isValid() const { return tile != NULL; }
+    int blockCount() const { return int(vertices.size() / 4); }
+
+    void addBlock(int x, int y, int size, SDL_Color color);
+    void flush(RenderStats& stats);
+
+private:
+    SDL_Renderer* renderer;
+    SDL_Texture* tile = NULL;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif // BLOCK_BATCH_H
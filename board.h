@@ -0,0 +1,354 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Board dimensions the game is built with, hidden rows included. Set
+// them with -DTETRIS_BOARD_WIDTH=N and -DTETRIS_BOARD_HEIGHT=N.
+#ifndef TETRIS_BOARD_WIDTH
+#define TETRIS_BOARD_WIDTH 10
+#endif
+#ifndef TETRIS_BOARD_HEIGHT
+#define TETRIS_BOARD_HEIGHT 24
+#endif
+
+// One bit per board row: bit y is set when row y is selected.
+typedef uint64_t RowMask;
+// One row of a piece's box: bit j is set when column j of the box is filled.
+typedef uint16_t PieceRowBits;
+
+// Narrowest unsigned word that holds a row of W cells
+template <int W>
+using RowWord = typename std::conditional<(W <= 8), uint8_t,
+                typename std::conditional<(W <= 16), uint16_t,
+                typename std::conditional<(W <= 32), uint32_t, uint64_t>::type>::type>::type;
+
+/**
+ * @brief Bitboard representation of a W x H playfield.
+ *
+ * Occupancy lives in `rows`, one word per row with bit x set when column
+ * x is filled, so collision and full-row tests are word operations. The
+ * word is the narrowest that holds W bits. `colors` is only read by the
+ * renderer and holds the color index of each filled cell (0 for empty).
+ * `hash` is the Zobrist hash of the occupancy, the XOR of ZOBRIST_CELLS
+ * over every filled cell. `heights` is the skyline: the height of each
+ * column's highest filled cell above the floor, 0 for an empty column.
+ * setCell and compactRows keep both up to date.
+ */
+template <int W, int H>
+struct BasicBoard {
+    static_assert(W >= 4 && W <= 64, "A row must hold a piece and fit in a 64-bit word");
+    static_assert(H >= 4 && H <= 64, "RowMask must hold every row");
+
+    typedef RowWord<W> Row;
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+    static constexpr Row FULL_ROW = Row(~uint64_t(0) >> (64 - W));
+
+    Row rows[H];
+    uint8_t colors[H][W];
+    uint64_t hash;
+    uint8_t heights[W];
+};
+
+// The board the game is played on
+typedef BasicBoard<TETRIS_BOARD_WIDTH, TETRIS_BOARD_HEIGHT> Board;
+typedef Board::Row RowBits;
+
+const int BOARD_WIDTH = Board::WIDTH;
+const int BOARD_HEIGHT = Board::HEIGHT;
+const RowBits FULL_ROW = Board::FULL_ROW;
+
+template <typename F, size_t... I>
+inline void unrollIndices(F& f, std::index_sequence<I...>) {
+    (f(int(I)), ...);
+}
+
+// Calls f(0) through f(N - 1), expanded at compile time instead of looped
+template <int N, typename F>
+inline void unroll(F f) {
+    unrollIndices(f, std::make_index_sequence<N>());
+}
+
+/**
+ * @brief SplitMix64 finalizer, used to derive the Zobrist keys at compile time.
+ */
+constexpr uint64_t mixBits(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Zobrist key of index i in a key table, from a fixed seed
+constexpr uint64_t zobristKey(uint64_t i) {
+    return mixBits(0x5A0B1E7F00000000ull + (i + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+template <int W, int H>
+struct ZobristTable {
+    uint64_t cells[H][W];
+};
+
+template <int W, int H>
+constexpr ZobristTable<W, H> buildZobristTable() {
+    ZobristTable<W, H> table{};
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            table.cells[y][x] = zobristKey(uint64_t(y * W + x));
+        }
+    }
+    return table;
+}
+
+// Zobrist keys of the cells of a W x H board
+template <int W, int H>
+constexpr ZobristTable<W, H> ZOBRIST_CELLS = buildZobristTable<W, H>();
+
+inline int popCount(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Index of the lowest set bit; bits must be non-zero
+inline int lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * @brief Empties every cell of the board.
+ *
+ * @param board The game board.
+ */
+template <int W, int H>
+inline void clearBoard(BasicBoard<W, H>& board) {
+    memset(&board, 0, sizeof(board));
+}
+
+template <int W, int H>
+inline bool isCellFilled(const BasicBoard<W, H>& board, int x, int y) {
+    return (board.rows[y] >> x) & 1;
+}
+
+// XOR of the Zobrist keys of the filled cells of one row
+template <int W, int H>
+inline uint64_t rowHash(int y, uint64_t bits) {
+    uint64_t hash = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        hash ^= ZOBRIST_CELLS<W, H>.cells[y][lowestBit(bits)];
+    }
+    return hash;
+}
+
+template <int W, int H>
+inline void setCell(BasicBoard<W, H>& board, int x, int y, int color) {
+    typedef typename BasicBoard<W, H>::Row Row;
+    if (!isCellFilled(board, x, y)) {
+        board.hash ^= ZOBRIST_CELLS<W, H>.cells[y][x];
+    }
+    board.rows[y] |= Row(Row(1) << x);
+    board.colors[y][x] = uint8_t(color);
+    if (board.heights[x] < H - y) {
+        board.heights[x] = uint8_t(H - y);
+    }
+}
+
+/**
+ * @brief Returns the rows that are completely filled.
+ *
+ * @param board The game board.
+ * @return RowMask Bit y is set when row y is full.
+ */
+template <int W, int H>
+inline RowMask fullRowMask(const BasicBoard<W, H>& board) {
+    RowMask mask = 0;
+    unroll<H>([&](int y) {
+        mask |= RowMask(board.rows[y] == BasicBoard<W, H>::FULL_ROW) << y;
+    });
+    return mask;
+}
+
+/**
+ * @brief Removes the selected rows and drops everything above them.
+ *
+ * Rows are compacted in a single bottom-up pass: each surviving row is
+ * moved straight to its final position, and the rows freed at the top
+ * are emptied. The hash is updated for the removed and moved rows only.
+ * A column whose top cell survives sinks by the number of rows removed
+ * below it; only a column whose top row was removed is scanned for its
+ * new top.
+ *
+ * @param board The game board.
+ * @param rowsToRemove Bit y is set for each row to remove.
+ * @return int The number of rows removed.
+ */
+template <int W, int H>
+int compactRows(BasicBoard<W, H>& board, RowMask rowsToRemove) {
+    if (rowsToRemove == 0) {
+        return 0;
+    }
+
+    int dst = H - 1;
+    for (int src = H - 1; src >= 0; src--) {
+        if ((rowsToRemove >> src) & 1) {
+            board.hash ^= rowHash<W, H>(src, board.rows[src]);
+            continue;
+        }
+        if (dst != src) {
+            board.hash ^= rowHash<W, H>(src, board.rows[src]) ^ rowHash<W, H>(dst, board.rows[src]);
+            board.rows[dst] = board.rows[src];
+            memcpy(board.colors[dst], board.colors[src], sizeof(board.colors[src]));
+        }
+        dst--;
+    }
+
+    int removed = dst + 1;
+    for (int y = 0; y < removed; y++) {
+        board.rows[y] = 0;
+        memset(board.colors[y], 0, sizeof(board.colors[y]));
+    }
+
+    for (int x = 0; x < W; x++) {
+        int top = H - board.heights[x];
+        if (top == H) {
+            continue;
+        }
+        if (!((rowsToRemove >> top) & 1)) {
+            board.heights[x] = uint8_t(board.heights[x] - popCount(rowsToRemove >> top));
+            continue;
+        }
+        int y = top;
+        while (y < H && !isCellFilled(board, x, y)) {
+            y++;
+        }
+        board.heights[x] = uint8_t(H - y);
+    }
+    return removed;
+}
+
+/**
+ * @brief Computes the Zobrist hash of the board from scratch.
+ *
+ * @param board The game board.
+ * @return uint64_t The value setCell and compactRows maintain in board.hash.
+ */
+template <int W, int H>
+inline uint64_t boardHash(const BasicBoard<W, H>& board) {
+    uint64_t hash = 0;
+    unroll<H>([&](int y) {
+        hash ^= rowHash<W, H>(y, board.rows[y]);
+    });
+    return hash;
+}
+
+/**
+ * @brief Recomputes the hash and the skyline from the occupancy, for
+ * boards whose rows were written directly.
+ *
+ * @param board The game board.
+ */
+template <int W, int H>
+void rebuildBoardIndex(BasicBoard<W, H>& board) {
+    board.hash = boardHash(board);
+    uint64_t seen = 0;
+    memset(board.heights, 0, sizeof(board.heights));
+    for (int y = 0; y < H; y++) {
+        for (uint64_t top = board.rows[y] & ~seen; top != 0; top &= top - 1) {
+            board.heights[lowestBit(top)] = uint8_t(H - y);
+        }
+        seen |= board.rows[y];
+    }
+}
+
+/**
+ * @brief Pushes every row up and fills the rows freed at the bottom with
+ * garbage: full rows with one hole.
+ *
+ * @param board The game board.
+ * @param count The number of garbage rows, at most H.
+ * @param hole The empty column of every garbage row.
+ * @param color The color index of the garbage cells.
+ * @return true if a filled cell was pushed off the top.
+ */
+template <int W, int H>
+bool raiseRows(BasicBoard<W, H>& board, int count, int hole, int color) {
+    typedef typename BasicBoard<W, H>::Row Row;
+    bool overflow = false;
+    for (int y = 0; y < count; y++) {
+        overflow |= board.rows[y] != 0;
+    }
+    memmove(board.rows, board.rows + count, (H - count) * sizeof(Row));
+    memmove(board.colors, board.colors + count, (H - count) * sizeof(board.colors[0]));
+
+    Row garbage = Row(BasicBoard<W, H>::FULL_ROW & ~(Row(1) << hole));
+    for (int y = H - count; y < H; y++) {
+        board.rows[y] = garbage;
+        memset(board.colors[y], color, sizeof(board.colors[y]));
+        board.colors[y][hole] = 0;
+    }
+    // Every row moved, so the hash and skyline are rebuilt
+    rebuildBoardIndex(board);
+    return overflow;
+}
+
+/**
+ * @brief Tests a piece, given as per-row bit masks, against the board.
+ *
+ * @param board The game board.
+ * @param pieceRows Bit masks of the piece, bit j set for column j of the piece.
+ * @param numRows The number of entries in pieceRows.
+ * @param x The board column of the piece's left edge.
+ * @param y The board row of the piece's top edge.
+ * @return true if any cell is out of bounds or overlaps a filled cell.
+ */
+template <int W, int H>
+inline bool collides(const BasicBoard<W, H>& board, const PieceRowBits* pieceRows, int numRows, int x, int y) {
+    for (int i = 0; i < numRows; i++) {
+        uint64_t bits = pieceRows[i];
+        if (bits == 0) {
+            continue;
+        }
+        int boardY = y + i;
+        if (boardY < 0 || boardY >= H) {
+            return true;
+        }
+        if (x < 0) {
+            // Any cell left of column 0 is out of bounds
+            if (bits & ((uint64_t(1) << -x) - 1)) {
+                return true;
+            }
+            bits >>= -x;
+        } else if (x > W - 16 && (x >= W || (bits >> (W - x)) != 0)) {
+            // A cell right of the last column; a mask of 16 bits or less
+            // can only reach past it from the last 16 columns
+            return true;
+        } else {
+            bits <<= x;
+        }
+        if (bits & board.rows[boardY]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // BOARD_H
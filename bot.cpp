@@ -0,0 +1,416 @@
+#include "bot.h"
+#include "evaluator.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+// Value of a placement that tops out or leaves no room for the next piece
+const double LOSS_VALUE = -1e9;
+
+// Heuristic weights for the evaluation features
+const double HEIGHT_WEIGHT = -0.510066;
+const double LINES_WEIGHT = 0.760666;
+const double HOLES_WEIGHT = -0.35663;
+const double BUMPINESS_WEIGHT = -0.184483;
+
+static_assert(MAX_PLACEMENTS <= BATCH_SIZE, "Every placement of a piece must fit in one evaluation batch");
+static_assert(MAX_PLACEMENTS <= 256, "The transposition table stores the best placement in 8 bits");
+
+
+/**
+ * @brief Lists the landing spots of a piece reachable by rotating it at the
+ * spawn position, shifting it sideways and dropping it straight down.
+ *
+ * Uses the same fit test and wall kicks as the game itself.
+ *
+ * @param board The game board.
+ * @param type The piece type.
+ * @param placements Receives up to MAX_PLACEMENTS locked pieces.
+ * @return int The number of placements found.
+ */
+int findPlacements(const Board& board, int type, Tetromino* placements) {
+    int count = 0;
+    Tetromino rotated = spawnTetromino(type);
+    if (!pieceFits(rotated, board)) {
+        return 0;
+    }
+
+    for (int rotation = 0; rotation < ROTATION_COUNT; rotation++) {
+        if (rotation > 0) {
+            int previous = rotated.rotation;
+            rotateTetromino(rotated, board);
+            if (rotated.rotation == previous) {
+                break;
+            }
+        }
+
+        // Sweep left from the rotated position, then right of it
+        for (int direction = -1; direction <= 1; direction += 2) {
+            Tetromino moved = rotated;
+            if (direction > 0) {
+                moved.x += 1;
+            }
+            while (pieceFits(moved, board) && count < MAX_PLACEMENTS) {
+                Tetromino dropped = moved;
+                while (pieceFits(dropped, board)) {
+                    dropped.y += 1;
+                }
+                dropped.y -= 1;
+                placements[count++] = dropped;
+                moved.x += direction;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Locks a placement into the board and removes any rows it completes.
+ *
+ * @param board The board to modify.
+ * @param placement The piece at its final position.
+ * @return int The number of rows cleared.
+ */
+int applyPlacement(Board& board, const Tetromino& placement) {
+    int color = pieceColor(placement.type);
+    for (const PieceCell& cell : pieceShape(placement).cells) {
+        setCell(board, placement.x + cell.x, placement.y + cell.y, color);
+    }
+    return compactRows(board, fullRowMask(board));
+}
+
+/**
+ * @brief Measures the heuristic features of a board.
+ *
+ * @param board The game board.
+ * @param lines The rows cleared on the way to this board.
+ */
+BoardFeatures boardFeatures(const Board& board, int lines) {
+    int heights[BOARD_WIDTH] = {};
+    int holes = 0;
+    RowBits seen = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        RowBits row = board.rows[y];
+        // Empty cells under a filled cell are holes
+        holes += popCount(seen & ~row);
+        for (RowBits top = row & ~seen; top != 0; top &= top - 1) {
+            heights[lowestBit(top)] = BOARD_HEIGHT - y;
+        }
+        seen |= row;
+    }
+
+    BoardFeatures features = { 0, holes, 0, lines };
+    for (int x = 0; x < BOARD_WIDTH; x++) {
+        features.aggregateHeight += heights[x];
+        if (x > 0) {
+            features.bumpiness += abs(heights[x] - heights[x - 1]);
+        }
+    }
+    return features;
+}
+
+// The weighted sum shared by evaluateBoard and the batched evaluation
+static double weighFeatures(int aggregateHeight, int lines, int holes, int bumpiness) {
+    return HEIGHT_WEIGHT * aggregateHeight
+        + LINES_WEIGHT * lines
+        + HOLES_WEIGHT * holes
+        + BUMPINESS_WEIGHT * bumpiness;
+}
+
+double evaluateBoard(const Board& board, int lines) {
+    BoardFeatures features = boardFeatures(board, lines);
+    return weighFeatures(features.aggregateHeight, features.lines, features.holes, features.bumpiness);
+}
+
+
+Bot::Bot(const BotConfig& config)
+    : settings(config), pool(new WorkStealingPool(config.threads)) {
+    if (config.tableMegabytes > 0) {
+        table.reset(new TranspositionTable(size_t(config.tableMegabytes), config.replacement));
+    }
+}
+
+/**
+ * @brief Best value reachable by placing a known piece, searching `depth` pieces.
+ */
+double Bot::searchPiece(const Board& board, int type, int depth, int lines, SearchCount& count) {
+    uint64_t key = 0;
+    if (table) {
+        key = searchKey(board.hash ^ activePieceKey(type), depth, lines);
+        TableHit hit;
+        count.probes++;
+        if (table->probe(key, hit)) {
+            count.hits++;
+            count.nodesSaved += hit.nodes;
+            return hit.value;
+        }
+    }
+    uint64_t workBefore = count.nodes + count.nodesSaved;
+
+    Tetromino placements[MAX_PLACEMENTS];
+    int placementCount = findPlacements(board, type, placements);
+    double best = LOSS_VALUE;
+    int bestIndex = 0;
+    if (depth <= 1) {
+        // Last piece of the search: evaluate the boards of all placements at once
+        BoardBatch batch;
+        int totals[MAX_PLACEMENTS];
+        for (int i = 0; i < placementCount; i++) {
+            Board next = board;
+            totals[i] = lines + applyPlacement(next, placements[i]);
+            batch.add(next);
+        }
+        BatchFeatures features;
+        evaluateBatch(batch, features);
+        count.nodes += placementCount;
+        for (int i = 0; i < placementCount; i++) {
+            double value = weighFeatures(features.aggregateHeight[i], totals[i], features.holes[i], features.bumpiness[i]);
+            if (value > best) {
+                best = value;
+                bestIndex = i;
+            }
+        }
+    }
+    for (int i = 0; depth > 1 && i < placementCount; i++) {
+        count.nodes++;
+        Board next = board;
+        int total = lines + applyPlacement(next, placements[i]);
+        double value = searchUnknown(next, depth - 1, total, count);
+        if (value > best) {
+            best = value;
+            bestIndex = i;
+        }
+    }
+
+    if (table) {
+        table->store(key, depth, best, bestIndex, count.nodes + count.nodesSaved - workBefore);
+    }
+    return best;
+}
+
+/**
+ * @brief Expected value over all piece types of searching `depth` more pieces.
+ */
+double Bot::searchUnknown(const Board& board, int depth, int lines, SearchCount& count) {
+    double sum = 0;
+    for (int type = 0; type < PIECE_COUNT; type++) {
+        sum += searchPiece(board, type, depth, lines, count);
+    }
+    return sum / PIECE_COUNT;
+}
+
+/**
+ * @brief Searches for the best landing spot of the current piece.
+ *
+ * Every placement of the current piece becomes a task. At depth 2 a task
+ * evaluates every placement of the next piece as one batch; deeper, it
+ * submits a task per placement of the next piece, so idle threads can
+ * steal the subtrees of a busy one.
+ *
+ * With a transposition table the whole search is looked up first, keyed
+ * by the game's position hash, and each root placement is looked up as
+ * the search of the next piece on the board it leaves.
+ *
+ * @param state The game to search.
+ * @return Tetromino The chosen placement, or the current piece if it has none.
+ */
+Tetromino Bot::choosePlacement(const GameState& state) {
+    ProfileScope profile(PHASE_BOT);
+    auto start = chrono::steady_clock::now();
+    int depth = settings.depth;
+
+    Tetromino roots[MAX_PLACEMENTS];
+    int rootCount = findPlacements(state.board, state.current.type, roots);
+    if (rootCount == 0) {
+        return state.current;
+    }
+
+    uint64_t rootKey = 0;
+    if (table) {
+        table->newSearch();
+        rootKey = searchKey(state.positionHash(), depth, 0);
+        TableHit hit;
+        totals.probes++;
+        if (table->probe(rootKey, hit) && hit.best < rootCount) {
+            totals.searches++;
+            totals.hits++;
+            totals.nodesSaved += hit.nodes;
+            totals.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return roots[hit.best];
+        }
+    }
+
+    vector<double> rootValues(rootCount, LOSS_VALUE);
+    vector<uint64_t> rootKeys(rootCount, 0);
+    vector<char> rootDone(rootCount, false);
+    vector<uint64_t> rootWork(rootCount, 0);
+    vector<vector<double>> childValues(rootCount);
+    vector<vector<uint64_t>> childWork(rootCount);
+    // Boards and next-piece placements of the roots, kept until the group
+    // is done so child tasks only capture indices into them
+    vector<Board> rootBoards(rootCount);
+    vector<int> rootLines(rootCount, 0);
+    vector<Tetromino> childPlacements(size_t(rootCount) * MAX_PLACEMENTS);
+    atomic<uint64_t> nodes(0);
+    atomic<uint64_t> probes(0);
+    atomic<uint64_t> hits(0);
+    atomic<uint64_t> nodesSaved(0);
+    auto addCount = [&](const SearchCount& count) {
+        nodes.fetch_add(count.nodes, memory_order_relaxed);
+        probes.fetch_add(count.probes, memory_order_relaxed);
+        hits.fetch_add(count.hits, memory_order_relaxed);
+        nodesSaved.fetch_add(count.nodesSaved, memory_order_relaxed);
+    };
+    // Submitted through a reference so each child task holds one pointer
+    // and two indices, small enough for std::function to store without
+    // allocating
+    auto searchChild = [&](int i, int j) {
+        SearchCount count;
+        count.nodes = 1;
+        Board next = rootBoards[i];
+        int total = rootLines[i] + applyPlacement(next, childPlacements[size_t(i) * MAX_PLACEMENTS + j]);
+        childValues[i][j] = searchUnknown(next, depth - 2, total, count);
+        childWork[i][j] = count.nodes + count.nodesSaved;
+        addCount(count);
+    };
+    TaskGroup group;
+
+    for (int i = 0; i < rootCount; i++) {
+        pool->submit(group, [&, i] {
+            Board& board = rootBoards[i];
+            board = state.board;
+            int lines = applyPlacement(board, roots[i]);
+            rootLines[i] = lines;
+            nodes.fetch_add(1, memory_order_relaxed);
+            if (depth <= 1) {
+                rootValues[i] = evaluateBoard(board, lines);
+                return;
+            }
+
+            // The children of a root are the search of the next piece on its board
+            if (depth == 2) {
+                SearchCount count;
+                rootValues[i] = searchPiece(board, state.next.type, 1, lines, count);
+                rootWork[i] = count.nodes + count.nodesSaved;
+                rootDone[i] = true;
+                addCount(count);
+                return;
+            }
+            if (table) {
+                rootKeys[i] = searchKey(board.hash ^ activePieceKey(state.next.type), depth - 1, lines);
+                TableHit hit;
+                probes.fetch_add(1, memory_order_relaxed);
+                if (table->probe(rootKeys[i], hit)) {
+                    hits.fetch_add(1, memory_order_relaxed);
+                    nodesSaved.fetch_add(hit.nodes, memory_order_relaxed);
+                    rootValues[i] = hit.value;
+                    rootWork[i] = hit.nodes;
+                    rootDone[i] = true;
+                    return;
+                }
+            }
+
+            int childCount = findPlacements(board, state.next.type, &childPlacements[size_t(i) * MAX_PLACEMENTS]);
+            childValues[i].assign(childCount, LOSS_VALUE);
+            childWork[i].assign(childCount, 0);
+            for (int j = 0; j < childCount; j++) {
+                pool->submit(group, [&searchChild, i, j] {
+                    searchChild(i, j);
+                });
+            }
+        });
+    }
+    pool->wait(group);
+
+    // Reduce in placement order so the choice does not depend on scheduling
+    int best = 0;
+    double bestValue = LOSS_VALUE;
+    for (int i = 0; i < rootCount; i++) {
+        double value = rootValues[i];
+        if (depth > 1 && !rootDone[i]) {
+            value = LOSS_VALUE;
+            int bestChild = 0;
+            for (size_t j = 0; j < childValues[i].size(); j++) {
+                if (childValues[i][j] > value) {
+                    value = childValues[i][j];
+                    bestChild = int(j);
+                }
+                rootWork[i] += childWork[i][j];
+            }
+            if (table) {
+                table->store(rootKeys[i], depth - 1, value, bestChild, rootWork[i]);
+            }
+        }
+        if (i == 0 || value > bestValue) {
+            best = i;
+            bestValue = value;
+        }
+    }
+    if (table) {
+        uint64_t work = rootCount;
+        for (uint64_t rootNodes : rootWork) {
+            work += rootNodes;
+        }
+        table->store(rootKey, depth, bestValue, best, work);
+    }
+
+    totals.searches++;
+    totals.nodes += nodes.load();
+    totals.probes += probes.load();
+    totals.hits += hits.load();
+    totals.nodesSaved += nodesSaved.load();
+    totals.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return roots[best];
+}
+
+/**
+ * @brief Returns the buttons to hold for the next tick.
+ *
+ * Searches once per spawned piece, then rotates, shifts and soft drops
+ * towards the chosen placement. Every press is followed by a tick with
+ * nothing held, since the game acts on buttons going down.
+ *
+ * @param state The game being played.
+ */
+Input Bot::nextInput(const GameState& state) {
+    return nextInput(state, steering);
+}
+
+/**
+ * @brief Returns the buttons to hold for the next tick of one of many
+ * games played by this bot.
+ *
+ * @param state The game being played.
+ * @param plan That game's plan, carried from its previous tick.
+ */
+Input Bot::nextInput(const GameState& state, BotPlan& plan) {
+    if (state.gameOver) {
+        return INPUT_NONE;
+    }
+    if (state.pieceCount != plan.plannedPiece) {
+        plan.target = choosePlacement(state);
+        plan.plannedPiece = state.pieceCount;
+        plan.lastInput = INPUT_NONE;
+    }
+    if (plan.lastInput != INPUT_NONE) {
+        plan.lastInput = INPUT_NONE;
+        return INPUT_NONE;
+    }
+
+    const Tetromino& current = state.current;
+    const Tetromino& target = plan.target;
+    if (current.rotation != target.rotation) {
+        plan.lastInput = INPUT_ROTATE;
+    } else if (current.x < target.x) {
+        plan.lastInput = INPUT_RIGHT;
+    } else if (current.x > target.x) {
+        plan.lastInput = INPUT_LEFT;
+    } else {
+        plan.lastInput = INPUT_SOFT_DROP;
+    }
+    return plan.lastInput;
+}
@@ -0,0 +1,99 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <cstdint>
+#include <memory>
+#include "game.h"
+#include "thread_pool.h"
+#include "transposition.h"
+
+struct BotConfig {
+    int depth = 2;   // pieces searched: 1 = current, 2 = current and next, more averages over unknown pieces
+    int threads = 1; // threads used by the placement search
+    int tableMegabytes = 0; // transposition table size; 0 searches without one
+    ReplacementPolicy replacement = REPLACE_DEPTH_PREFERRED;
+};
+
+// Work done by one part of a search
+struct SearchCount {
+    uint64_t nodes = 0;      // placements searched
+    uint64_t probes = 0;     // transposition table lookups
+    uint64_t hits = 0;       // lookups answered from the table
+    uint64_t nodesSaved = 0; // placements the hits did not have to search again
+};
+
+// Running totals of the work done by the search
+struct BotStats {
+    uint64_t searches = 0;
+    uint64_t nodes = 0;
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t nodesSaved = 0;
+    double seconds = 0;
+
+    double nodesPerSecond() const { return seconds > 0 ? nodes / seconds : 0; }
+    double hitRate() const { return probes > 0 ? double(hits) / probes : 0; }
+};
+
+// Heuristic features of a board after a placement
+struct BoardFeatures {
+    int aggregateHeight;
+    int holes;
+    int bumpiness;
+    int lines;
+};
+
+int findPlacements(const Board& board, int type, Tetromino* placements);
+int applyPlacement(Board& board, const Tetromino& placement);
+BoardFeatures boardFeatures(const Board& board, int lines);
+double evaluateBoard(const Board& board, int lines);
+
+/**
+ * @brief Where the bot is steering the current piece of one game. Plain
+ * data, so a caller driving many games can keep one per game in an array
+ * and share a Bot between them.
+ */
+struct BotPlan {
+    int plannedPiece = 0; // pieceCount of the piece the target is for
+    Tetromino target;
+    Input lastInput = INPUT_NONE;
+};
+
+/**
+ * @brief Autoplay driver that searches placements and emits inputs to reach them.
+ *
+ * For every spawned piece it searches each landing spot of the current
+ * piece (and of the next one, and beyond that an average over all piece
+ * types, as deep as BotConfig::depth) on a work-stealing pool, then feeds
+ * the rotate, move and drop presses to GameState::step one tick at a time.
+ *
+ * With BotConfig::tableMegabytes set, search values are cached in a
+ * transposition table keyed by the board's Zobrist hash, the piece, the
+ * depth and the lines cleared, so a position reached by several move
+ * orders is searched once. Values are exact for their key, so the bot
+ * plays the same moves with or without the table.
+ */
+class Bot {
+public:
+    explicit Bot(const BotConfig& config);
+
+    Tetromino choosePlacement(const GameState& state);
+    Input nextInput(const GameState& state);
+    Input nextInput(const GameState& state, BotPlan& plan);
+
+    const BotConfig& config() const { return settings; }
+    const BotStats& stats() const { return totals; }
+
+private:
+    double searchPiece(const Board& board, int type, int depth, int lines, SearchCount& count);
+    double searchUnknown(const Board& board, int depth, int lines, SearchCount& count);
+
+    BotConfig settings;
+    BotStats totals;
+    std::unique_ptr<WorkStealingPool> pool;
+    std::unique_ptr<TranspositionTable> table; // null when disabled
+
+    BotPlan steering; // for the single-game nextInput
+};
+
+#endif // BOT_H
@@ -0,0 +1,224 @@
+#include "evaluator.h"
+
+// The vector kernels need RowBits to be 16 bits wide with room for a
+// wall bit on each side; other boards use the scalar kernel alone
+#if TETRIS_BOARD_WIDTH > 8 && TETRIS_BOARD_WIDTH + 2 <= 16
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TETRIS_SIMD_X86 1
+#define TARGET_SSE4 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TETRIS_SIMD_X86 1
+#define TARGET_SSE4
+#define TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+// Every feature is a sum over rows of the popcount of a mask built from
+// the row and `seen`, the columns filled at or above it:
+//   holes           seen above & ~row
+//   aggregateHeight seen (a column counts once per row at or below its top)
+//   bumpiness       columns whose seen bit differs from the next column's
+//   wells           empty seen-free cells with both neighbours seen or walls
+//   rowTransitions  bit changes along the row framed by two filled walls
+const uint64_t NEIGHBOUR_PAIRS = FULL_ROW >> 1;
+const uint64_t RIGHT_WALL = uint64_t(1) << (BOARD_WIDTH - 1);
+
+
+/**
+ * @brief Adds a board to the batch.
+ *
+ * @return int The board's index, or -1 if the batch is full.
+ */
+int BoardBatch::add(const Board& board) {
+    if (count >= BATCH_SIZE) {
+        return -1;
+    }
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        rows[y][count] = board.rows[y];
+    }
+    return count++;
+}
+
+static void evaluateScalar(const BoardBatch& batch, BatchFeatures& features) {
+    for (int i = 0; i < batch.count; i++) {
+        uint64_t seen = 0;
+        int height = 0, holes = 0, bumpiness = 0, wells = 0, transitions = 0;
+        for (int y = 0; y < BOARD_HEIGHT; y++) {
+            uint64_t row = batch.rows[y][i];
+            holes += popCount(seen & ~row);
+            seen |= row;
+            height += popCount(seen);
+            bumpiness += popCount((seen ^ (seen >> 1)) & NEIGHBOUR_PAIRS);
+            uint64_t walled = ((seen << 1) | 1) & ((seen >> 1) | RIGHT_WALL);
+            wells += popCount(walled & ~seen & FULL_ROW);
+            // Changes between neighbours inside the row, then at each wall
+            transitions += popCount((row ^ (row >> 1)) & NEIGHBOUR_PAIRS) + !(row & 1) + !(row & RIGHT_WALL);
+        }
+        features.aggregateHeight[i] = uint16_t(height);
+        features.holes[i] = uint16_t(holes);
+        features.bumpiness[i] = uint16_t(bumpiness);
+        features.wells[i] = uint16_t(wells);
+        features.rowTransitions[i] = uint16_t(transitions);
+    }
+}
+
+#if defined(TETRIS_SIMD_X86)
+
+// A row shifted up one bit between a wall bit on each side
+const RowBits FRAMED_ROW_WALLS = RowBits(1u | (1u << (BOARD_WIDTH + 1)));
+const RowBits FRAMED_ROW_PAIRS = RowBits((1u << (BOARD_WIDTH + 1)) - 1);
+static_assert(sizeof(RowBits) == 2, "The kernels load rows as 16-bit lanes");
+
+// Per-lane popcount of 16-bit lanes: a nibble lookup with pshufb, then
+// the two byte counts of each lane added
+TARGET_SSE4 static inline __m128i popCount16(__m128i v) {
+    const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(lookup, _mm_and_si128(v, nibble)),
+                                 _mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+    return _mm_add_epi16(_mm_and_si128(bytes, _mm_set1_epi16(0xFF)), _mm_srli_epi16(bytes, 8));
+}
+
+TARGET_SSE4 static void evaluateSse4(const BoardBatch& batch, BatchFeatures& features) {
+    const __m128i fullRow = _mm_set1_epi16(short(FULL_ROW));
+    const __m128i pairs = _mm_set1_epi16(short(NEIGHBOUR_PAIRS));
+    const __m128i leftWall = _mm_set1_epi16(1);
+    const __m128i rightWall = _mm_set1_epi16(short(RIGHT_WALL));
+    const __m128i framedWalls = _mm_set1_epi16(short(FRAMED_ROW_WALLS));
+    const __m128i framedPairs = _mm_set1_epi16(short(FRAMED_ROW_PAIRS));
+
+    for (int i = 0; i < batch.count; i += 8) {
+        __m128i seen = _mm_setzero_si128();
+        __m128i height = seen, holes = seen, bumpiness = seen, wells = seen, transitions = seen;
+        for (int y = 0; y < BOARD_HEIGHT; y++) {
+            __m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(&batch.rows[y][i]));
+            holes = _mm_add_epi16(holes, popCount16(_mm_andnot_si128(row, seen)));
+            seen = _mm_or_si128(seen, row);
+            height = _mm_add_epi16(height, popCount16(seen));
+            bumpiness = _mm_add_epi16(bumpiness, popCount16(_mm_and_si128(_mm_xor_si128(seen, _mm_srli_epi16(seen, 1)), pairs)));
+            __m128i walled = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(seen, 1), leftWall),
+                                           _mm_or_si128(_mm_srli_epi16(seen, 1), rightWall));
+            wells = _mm_add_epi16(wells, popCount16(_mm_andnot_si128(seen, _mm_and_si128(walled, fullRow))));
+            __m128i framed = _mm_or_si128(_mm_slli_epi16(row, 1), framedWalls);
+            transitions = _mm_add_epi16(transitions, popCount16(_mm_and_si128(_mm_xor_si128(framed, _mm_srli_epi16(framed, 1)), framedPairs)));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(&features.aggregateHeight[i]), height);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&features.holes[i]), holes);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&features.bumpiness[i]), bumpiness);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&features.wells[i]), wells);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&features.rowTransitions[i]), transitions);
+    }
+}
+
+TARGET_AVX2 static inline __m256i popCount16(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble)),
+                                    _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+    return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0xFF)), _mm256_srli_epi16(bytes, 8));
+}
+
+TARGET_AVX2 static void evaluateAvx2(const BoardBatch& batch, BatchFeatures& features) {
+    const __m256i fullRow = _mm256_set1_epi16(short(FULL_ROW));
+    const __m256i pairs = _mm256_set1_epi16(short(NEIGHBOUR_PAIRS));
+    const __m256i leftWall = _mm256_set1_epi16(1);
+    const __m256i rightWall = _mm256_set1_epi16(short(RIGHT_WALL));
+    const __m256i framedWalls = _mm256_set1_epi16(short(FRAMED_ROW_WALLS));
+    const __m256i framedPairs = _mm256_set1_epi16(short(FRAMED_ROW_PAIRS));
+
+    for (int i = 0; i < batch.count; i += 16) {
+        __m256i seen = _mm256_setzero_si256();
+        __m256i height = seen, holes = seen, bumpiness = seen, wells = seen, transitions = seen;
+        for (int y = 0; y < BOARD_HEIGHT; y++) {
+            __m256i row = _mm256_load_si256(reinterpret_cast<const __m256i*>(&batch.rows[y][i]));
+            holes = _mm256_add_epi16(holes, popCount16(_mm256_andnot_si256(row, seen)));
+            seen = _mm256_or_si256(seen, row);
+            height = _mm256_add_epi16(height, popCount16(seen));
+            bumpiness = _mm256_add_epi16(bumpiness, popCount16(_mm256_and_si256(_mm256_xor_si256(seen, _mm256_srli_epi16(seen, 1)), pairs)));
+            __m256i walled = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(seen, 1), leftWall),
+                                              _mm256_or_si256(_mm256_srli_epi16(seen, 1), rightWall));
+            wells = _mm256_add_epi16(wells, popCount16(_mm256_andnot_si256(seen, _mm256_and_si256(walled, fullRow))));
+            __m256i framed = _mm256_or_si256(_mm256_slli_epi16(row, 1), framedWalls);
+            transitions = _mm256_add_epi16(transitions, popCount16(_mm256_and_si256(_mm256_xor_si256(framed, _mm256_srli_epi16(framed, 1)), framedPairs)));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&features.aggregateHeight[i]), height);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&features.holes[i]), holes);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&features.bumpiness[i]), bumpiness);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&features.wells[i]), wells);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&features.rowTransitions[i]), transitions);
+    }
+}
+
+#endif // TETRIS_SIMD_X86
+
+/**
+ * @brief Tests whether the CPU and the build can run a kernel.
+ */
+bool kernelSupported(EvaluatorKernel kernel) {
+    switch (kernel) {
+    case KERNEL_SCALAR:
+        return true;
+#if defined(TETRIS_SIMD_X86) && defined(__GNUC__)
+    case KERNEL_SSE4:
+        return __builtin_cpu_supports("sse4.1");
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#elif defined(TETRIS_SIMD_X86)
+    case KERNEL_SSE4: {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+    }
+    case KERNEL_AVX2: {
+        // AVX2 needs the CPU flag and the OS saving the YMM registers
+        int info[4];
+        __cpuid(info, 1);
+        bool osSaves = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSaves && (info[1] & (1 << 5)) != 0;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief The widest kernel the CPU supports, detected once.
+ */
+EvaluatorKernel bestKernel() {
+    static const EvaluatorKernel best = kernelSupported(KERNEL_AVX2) ? KERNEL_AVX2
+        : kernelSupported(KERNEL_SSE4) ? KERNEL_SSE4 : KERNEL_SCALAR;
+    return best;
+}
+
+/**
+ * @brief Computes the features of every board in the batch.
+ *
+ * The vector kernels process whole groups of 8 or 16 boards; lanes past
+ * batch.count hold stale boards and their features are meaningless.
+ *
+ * @param batch The boards.
+ * @param features Receives the features of board i at index i.
+ * @param kernel The implementation to use; it must be supported.
+ */
+void evaluateBatch(const BoardBatch& batch, BatchFeatures& features, EvaluatorKernel kernel) {
+    switch (kernel) {
+#if defined(TETRIS_SIMD_X86)
+    case KERNEL_SSE4:
+        evaluateSse4(batch, features);
+        break;
+    case KERNEL_AVX2:
+        evaluateAvx2(batch, features);
+        break;
+#endif
+    default:
+        evaluateScalar(batch, features);
+        break;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <cstdint>
+#include "piece.h"
+
+// Boards per batch: every placement of a piece, rounded up to a multiple
+// of the widest kernel's lane count
+const int BATCH_SIZE = (MAX_PLACEMENTS + 15) / 16 * 16;
+static_assert(BATCH_SIZE % 16 == 0, "Kernels process boards 16 at a time");
+
+/**
+ * @brief Occupancy of many boards in struct-of-arrays layout: rows[y]
+ * holds row y of every board, so one vector load fetches the same row of
+ * 8 or 16 boards. Colors are not needed to evaluate a board and are left out.
+ */
+struct BoardBatch {
+    alignas(32) RowBits rows[BOARD_HEIGHT][BATCH_SIZE] = {};
+    int count = 0;
+
+    int add(const Board& board);
+};
+
+/**
+ * @brief Heuristic features of each board of a batch, also in
+ * struct-of-arrays layout.
+ *
+ * - aggregateHeight: sum of the column heights
+ * - holes: empty cells with a filled cell somewhere above them
+ * - bumpiness: sum of the height differences of neighbouring columns
+ * - wells: empty cells above a column's top with both neighbours (or the
+ *   wall) filled at that row
+ * - rowTransitions: changes between filled and empty along each row,
+ *   counting the walls as filled
+ */
+struct BatchFeatures {
+    alignas(32) uint16_t aggregateHeight[BATCH_SIZE];
+    alignas(32) uint16_t holes[BATCH_SIZE];
+    alignas(32) uint16_t bumpiness[BATCH_SIZE];
+    alignas(32) uint16_t wells[BATCH_SIZE];
+    alignas(32) uint16_t rowTransitions[BATCH_SIZE];
+};
+
+enum EvaluatorKernel {
+    KERNEL_SCALAR,
+    KERNEL_SSE4, // 8 boards per step
+    KERNEL_AVX2, // 16 boards per step
+    KERNEL_COUNT
+};
+
+const char* const KERNEL_NAMES[KERNEL_COUNT] = { "scalar", "sse4", "avx2" };
+
+bool kernelSupported(EvaluatorKernel kernel);
+EvaluatorKernel bestKernel();
+void evaluateBatch(const BoardBatch& batch, BatchFeatures& features, EvaluatorKernel kernel);
+
+/**
+ * @brief Computes the features of every board in the batch with the
+ * fastest kernel the CPU supports.
+ */
+inline void evaluateBatch(const BoardBatch& batch, BatchFeatures& features) {
+    evaluateBatch(batch, features, bestKernel());
+}
+
+#endif // EVALUATOR_H
@@ -0,0 +1,97 @@
+#include "text.h"
+
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+
+/**
+ * @brief Build step that rasterizes the HUD font into a header, so the
+ * game starts without opening or parsing a TrueType file.
+ *
+ * Usage: font_atlas_gen FONT.TTF OUTPUT.h
+ *
+ * The header holds the glyph rectangles and advances and the atlas
+ * coverage as constexpr arrays. Runs of transparent pixels, most of the
+ * atlas, are stored as a 0 byte followed by the run length.
+ */
+int main(int argc, char* args[]) {
+    if (argc != 3) {
+        cout << "Usage: font_atlas_gen FONT.TTF OUTPUT.h" << endl;
+        return 1;
+    }
+    if (TTF_Init() == -1) {
+        cout << "SDL_ttf could not initialize! TTF_Error: " << TTF_GetError() << endl;
+        return 1;
+    }
+    TTF_Font* font = TTF_OpenFont(args[1], FONT_SIZE);
+    if (font == NULL) {
+        cout << "Failed to load font! TTF_Error: " << TTF_GetError() << endl;
+        return 1;
+    }
+    GlyphSheet sheet;
+    bool rasterized = rasterizeGlyphs(font, sheet);
+    TTF_CloseFont(font);
+    TTF_Quit();
+    if (!rasterized) {
+        cout << "Failed to rasterize " << args[1] << endl;
+        return 1;
+    }
+
+    FILE* out = fopen(args[2], "w");
+    if (out == NULL) {
+        cout << "Failed to create " << args[2] << endl;
+        return 1;
+    }
+    const char* fontName = args[1];
+    for (const char* p = args[1]; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            fontName = p + 1;
+        }
+    }
+    fprintf(out, "// Generated by font_atlas_gen from %s; do not edit.\n", fontName);
+    fprintf(out, "#ifndef FONT_ATLAS_H\n#define FONT_ATLAS_H\n\n#include <cstdint>\n\n");
+    fprintf(out, "constexpr int EMBEDDED_FONT_SIZE = %d;\n", FONT_SIZE);
+    fprintf(out, "constexpr int EMBEDDED_LINE_HEIGHT = %d;\n", sheet.lineHeight);
+    fprintf(out, "constexpr int EMBEDDED_ATLAS_WIDTH = %d;\n", ATLAS_WIDTH);
+    fprintf(out, "constexpr int EMBEDDED_ATLAS_HEIGHT = %d;\n\n", sheet.atlasHeight);
+
+    fprintf(out, "// x, y, w, h and advance of each glyph from '%c' to '%c'\n", FIRST_GLYPH, LAST_GLYPH);
+    fprintf(out, "constexpr int16_t EMBEDDED_GLYPHS[%d][5] = {\n", GLYPH_COUNT);
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        const SDL_Rect& source = sheet.sources[i];
+        fprintf(out, "    { %d, %d, %d, %d, %d },\n", source.x, source.y, source.w, source.h, sheet.advances[i]);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Atlas alpha, row by row; a 0 byte is followed by the length of its run of zeros\n");
+    fprintf(out, "constexpr uint8_t EMBEDDED_ATLAS_RLE[] = {");
+    size_t written = 0;
+    auto put = [&](int value) {
+        fprintf(out, "%s%d,", written % 24 == 0 ? "\n    " : " ", value);
+        written++;
+    };
+    for (size_t i = 0; i < sheet.alpha.size();) {
+        if (sheet.alpha[i] != 0) {
+            put(sheet.alpha[i++]);
+            continue;
+        }
+        int run = 0;
+        while (i < sheet.alpha.size() && sheet.alpha[i] == 0 && run < 255) {
+            run++;
+            i++;
+        }
+        put(0);
+        put(run);
+    }
+    fprintf(out, "\n};\n\n#endif // FONT_ATLAS_H\n");
+    bool failed = ferror(out) != 0;
+    if (fclose(out) != 0 || failed) {
+        cout << "Failed to write " << args[2] << endl;
+        return 1;
+    }
+    cout << "Embedded " << GLYPH_COUNT << " glyphs at " << FONT_SIZE << " pt: " << ATLAS_WIDTH << "x" << sheet.atlasHeight
+         << " atlas in " << written << " bytes" << endl;
+    return 0;
+}
@@ -0,0 +1,412 @@
+#include "game.h"
+#include "log.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+
+/**
+ * @brief Advances a SplitMix64 generator and returns its next 64 bits.
+ */
+static uint64_t splitMix64(uint64_t& state) {
+    return mixBits(state += 0x9E3779B97F4A7C15ull);
+}
+
+/**
+ * @brief Starts a new game with an empty board and two random pieces.
+ *
+ * @param seed Seeds the piece sequence; the same seed and rules always
+ * give the same pieces.
+ */
+void GameState::reset(uint64_t seed) {
+    rngState = seed;
+    garbageRngState = mixBits(seed ^ 0x6A72B46E5F0C3D21ull);
+    incomingGarbage = 0;
+    outgoingGarbage = 0;
+    bagIndex = PIECE_COUNT;
+    clearBoard(board);
+    current = spawnTetromino(randomPiece());
+    next = spawnTetromino(randomPiece());
+    score = 0;
+    level = 1;
+    linesCleared = 0;
+    clearedRowsCount = 0;
+    dropTicks = gravityTicks(level);
+    dropTimer = 0;
+    heldInput = INPUT_NONE;
+    pendingClear = 0;
+    clearTimer = 0;
+    gameOver = false;
+    tick = 0;
+    pieceCount = 1;
+    shiftTimer = 0;
+}
+
+/**
+ * @brief Advances the game by one tick.
+ *
+ * @param input The buttons held during this tick.
+ *
+ * Rows completed by a lock stay on the board in pendingClear until the
+ * line clear delay has passed; then they are removed and the next piece
+ * spawns.
+ */
+void GameState::step(Input input) {
+    Input pressed = input & ~heldInput;
+    heldInput = input;
+    if (gameOver) {
+        return;
+    }
+    tick++;
+
+    if (pendingClear != 0) {
+        clearTimer++;
+        if (clearTimer < LINE_CLEAR_TICKS) {
+            return;
+        }
+        {
+            ProfileScope profile(PHASE_LINE_CLEAR);
+            scoreLines(clearFullRows(board, pendingClear));
+        }
+        pendingClear = 0;
+        spawnNext();
+        return;
+    }
+
+    if (pressed & INPUT_ROTATE) {
+        rotateTetromino(current, board);
+    }
+    if (pressed & (INPUT_LEFT | INPUT_RIGHT)) {
+        shiftTimer = 0;
+        if (pressed & INPUT_RIGHT) {
+            shift(1);
+        }
+        if (pressed & INPUT_LEFT) {
+            shift(-1);
+        }
+    } else {
+        // Auto-repeat while exactly one direction stays held
+        Input held = input & (INPUT_LEFT | INPUT_RIGHT);
+        if (held == INPUT_LEFT || held == INPUT_RIGHT) {
+            shiftTimer++;
+            if (shiftTimer >= dasTicks && (shiftTimer - dasTicks) % max(arrTicks, 1) == 0) {
+                shift(held == INPUT_RIGHT ? 1 : -1);
+            }
+        } else {
+            shiftTimer = 0;
+        }
+    }
+    if (pressed & INPUT_HARD_DROP) {
+        // One row past the landing row, so handleCollision steps back and locks
+        current.y += dropDistance(current, board) + 1;
+        handleCollision(current, board);
+        lockPiece();
+        return;
+    }
+    if (pressed & INPUT_SOFT_DROP) {
+        current.y += 1;
+        if (handleCollision(current, board)) {
+            lockPiece();
+            return;
+        }
+    }
+
+    // Drop the tetromino at the interval for the current level
+    dropTimer++;
+    if (dropTimer >= dropTicks) {
+        ProfileScope profile(PHASE_GRAVITY);
+        dropTimer = 0;
+        current.y += 1;
+        if (handleCollision(current, board)) {
+            lockPiece();
+        }
+    }
+}
+
+/**
+ * @brief Moves the current piece one column, unless it would collide.
+ *
+ * @param dx 1 to move right, -1 to move left.
+ */
+void GameState::shift(int dx) {
+    current.x += dx;
+    if (checkCollision(current, board)) {
+        current.x -= dx;
+    }
+}
+
+/**
+ * @brief Finishes a lock: queues full rows for clearing, or spawns the next piece.
+ */
+void GameState::lockPiece() {
+    RowMask fullRows;
+    {
+        ProfileScope profile(PHASE_LINE_CLEAR);
+        fullRows = getFullRows(board);
+    }
+    if (fullRows != 0) {
+        LOG_DEBUG_BOARD(board);
+        pendingClear = fullRows;
+        clearTimer = 0;
+    } else {
+        if (incomingGarbage > 0) {
+            raiseGarbage();
+        }
+        spawnNext();
+    }
+}
+
+/**
+ * @brief Raises the queued garbage under the stack, ending the game if
+ * it pushes any block off the top.
+ */
+void GameState::raiseGarbage() {
+    int rows = min(incomingGarbage, BOARD_HEIGHT);
+    incomingGarbage = 0;
+    int hole = int(splitMix64(garbageRngState) % BOARD_WIDTH);
+    if (raiseRows(board, rows, hole, GARBAGE_COLOR)) {
+        gameOver = true;
+    }
+    LOG_DEBUG("Raised %d garbage rows, hole in column %d", rows, hole);
+}
+
+/**
+ * @brief Returns the next 64 bits of the game's piece PRNG.
+ */
+uint64_t GameState::nextRandom() {
+    return splitMix64(rngState);
+}
+
+/**
+ * @brief Draws the type of the next piece according to the randomizer rule.
+ */
+int GameState::randomPiece() {
+    if (rules.randomizer == RANDOMIZER_UNIFORM) {
+        return int(nextRandom() % PIECE_COUNT);
+    }
+    if (bagIndex >= PIECE_COUNT) {
+        // Refill and Fisher-Yates shuffle the bag
+        for (int i = 0; i < PIECE_COUNT; i++) {
+            bag[i] = uint8_t(i);
+        }
+        for (int i = PIECE_COUNT - 1; i > 0; i--) {
+            int j = int(nextRandom() % uint64_t(i + 1));
+            swap(bag[i], bag[j]);
+        }
+        bagIndex = 0;
+    }
+    return bag[bagIndex++];
+}
+
+void GameState::spawnNext() {
+    current = next;
+    next = spawnTetromino(randomPiece());
+    pieceCount++;
+    if (isGameOver(current, board)) {
+        gameOver = true;
+    }
+}
+
+/**
+ * @brief Updates score, level and gravity for a line clear.
+ *
+ * @param lines The number of rows cleared at once.
+ */
+void GameState::scoreLines(int lines) {
+    static const int NES_POINTS[] = { 0, 40, 100, 300, 1200 };
+    static const int GUIDELINE_POINTS[] = { 0, 100, 300, 500, 800 };
+
+    clearedRowsCount += lines; // Increment the counter by the number of cleared rows
+    linesCleared += lines;
+    int index = min(lines, 4);
+
+    // Sent garbage first cancels garbage still waiting to rise
+    int sent = GARBAGE_LINES[index];
+    int cancelled = min(sent, incomingGarbage);
+    incomingGarbage -= cancelled;
+    outgoingGarbage += sent - cancelled;
+
+    switch (rules.scoring) {
+    case SCORING_NES:
+        score += NES_POINTS[index] * level;
+        break;
+    case SCORING_GUIDELINE:
+        score += GUIDELINE_POINTS[index] * level;
+        break;
+    default:
+        score += lines * lines * 100; // Increase the score based on the number of cleared lines
+        break;
+    }
+
+    switch (rules.leveling) {
+    case LEVELING_TEN_LINES:
+        if (clearedRowsCount >= level * 10) {
+            level++;
+            linesCleared -= 10;
+        }
+        break;
+    case LEVELING_VARIABLE_GOAL:
+        if (linesCleared >= level * 5) {
+            linesCleared -= level * 5;
+            level++;
+        }
+        break;
+    default:
+        break;
+    }
+    dropTicks = gravityTicks(level);
+}
+
+/**
+ * @brief Returns the ticks between gravity drops at a level.
+ *
+ * @param level The level, starting at 1.
+ */
+int gravityTicks(int level) {
+    int index = min(max(level, 1), GRAVITY_LEVELS) - 1;
+    return max(1, GRAVITY_FRAMES[index] * TICKS_PER_SECOND / 60);
+}
+
+
+bool isGameOver(const Tetromino& tetromino, const Board& board) {
+    return checkCollision(tetromino, board);
+}
+
+/**
+ * @brief Returns the full rows on the board.
+ *
+ * @param board The game board.
+ * @return RowMask Bit y is set when row y is full.
+ */
+RowMask getFullRows(const Board& board) {
+    return fullRowMask(board);
+}
+
+
+/**
+ * @brief Prints the board's color indices to the console. For dumps from
+ * the game itself use LOG_DEBUG_BOARD, which does not block on output.
+ *
+ * @param board The game board.
+ */
+void printBoard(const Board& board) {
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            cout << int(board.colors[y][x]) << " ";
+        }
+        cout << endl;
+    }
+}
+
+
+/**
+ * @brief Clears the full rows from the board.
+ *
+ * @param board The game board.
+ * @param fullRows The full rows to clear, bit y set for row y.
+ * @return int The number of rows cleared.
+ */
+int clearFullRows(Board& board, RowMask fullRows) {
+    int lines = compactRows(board, fullRows);
+    LOG_DEBUG("Cleared %d rows, mask 0x%llx", lines, static_cast<unsigned long long>(fullRows));
+    LOG_DEBUG_BOARD(board);
+    return lines;
+}
+
+/**
+ * @brief Returns how many rows the Tetromino can fall before it lands.
+ *
+ * While every column of the piece is above the board's skyline this is
+ * the smallest gap between a column's lowest cell and the column's top,
+ * one subtraction per column. A piece tucked under an overhang falls back
+ * to probing one row at a time.
+ *
+ * @param tetromino The Tetromino, at a position where it fits.
+ * @param board The game board.
+ * @return int The number of rows it can move down.
+ */
+int dropDistance(const Tetromino& tetromino, const Board& board) {
+    const PieceShape& shape = pieceShape(tetromino);
+    int distance = BOARD_HEIGHT;
+    for (int column = 0; column < PIECE_BOX_SIZE; column++) {
+        if (shape.bottoms[column] == 0) {
+            continue;
+        }
+        int below = tetromino.y + shape.bottoms[column];
+        int surface = BOARD_HEIGHT - board.heights[tetromino.x + column];
+        if (below > surface) {
+            Tetromino probe = tetromino;
+            do {
+                probe.y++;
+            } while (pieceFits(probe, board));
+            return probe.y - 1 - tetromino.y;
+        }
+        distance = min(distance, surface - below);
+    }
+    return distance;
+}
+
+/**
+ * @brief Checks for collision between the Tetromino and the game board.
+ *
+ * @param tetromino The Tetromino to check for collision.
+ * @param board The game board.
+ * @return true if there is a collision, false otherwise.
+ */
+bool checkCollision(const Tetromino& tetromino, const Board& board) {
+    // Check if the Tetromino is out of bounds or collides with existing blocks
+    if (!pieceFits(tetromino, board)) {
+        LOG_TRACE("Collision detected at (%d, %d)", tetromino.x, tetromino.y);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Handles collision detection and places the Tetromino on the board.
+ *
+ * @param tetromino The Tetromino to handle.
+ * @param board The game board.
+ */
+bool handleCollision(Tetromino& tetromino, Board& board) {
+    if (checkCollision(tetromino, board)) {
+        tetromino.y -= 1;
+        // Place the tetromino on the board and spawn a new one
+        int color = pieceColor(tetromino.type);
+        for (const PieceCell& cell : pieceShape(tetromino).cells) {
+            setCell(board, tetromino.x + cell.x, tetromino.y + cell.y, color);
+        }
+        LOG_DEBUG("Tetromino placed at (%d, %d)", tetromino.x, tetromino.y);
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Rotates the Tetromino if possible, trying each wall kick in turn.
+ *
+ * @param tetromino The Tetromino to rotate.
+ * @param board The game board.
+ * @param direction 1 to rotate clockwise, -1 to rotate counter-clockwise.
+ */
+void rotateTetromino(Tetromino& tetromino, const Board& board, int direction) {
+    int rotation = (tetromino.rotation + (direction > 0 ? 1 : ROTATION_COUNT - 1)) % ROTATION_COUNT;
+    const PieceShape& rotatedShape = pieceShape(tetromino.type, rotation);
+    const int8_t (*kicks)[2] = wallKicks(tetromino.type, tetromino.rotation, direction);
+
+    for (int i = 0; i < KICK_COUNT; i++) {
+        int x = tetromino.x + kicks[i][0];
+        int y = tetromino.y - kicks[i][1];
+        if (!collides(board, rotatedShape.rows, PIECE_BOX_SIZE, x, y)) {
+            tetromino.rotation = rotation;
+            tetromino.x = x;
+            tetromino.y = y;
+            return;
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <cstdint>
+#include "board.h"
+#include "piece.h"
+
+// Simulation timing. The game runs at a fixed tick rate, independent of the frame rate.
+const int TICKS_PER_SECOND = 120;
+const int LINE_CLEAR_DELAY = 750; // milliseconds full rows stay on the board before they are removed
+const int LINE_CLEAR_TICKS = LINE_CLEAR_DELAY * TICKS_PER_SECOND / 1000;
+
+// Default horizontal auto-repeat: a held left or right waits the delayed
+// auto-shift, then repeats every auto-repeat rate
+const int DAS_DELAY = 167; // milliseconds
+const int ARR_DELAY = 33;  // milliseconds
+const int DAS_TICKS = DAS_DELAY * TICKS_PER_SECOND / 1000;
+const int ARR_TICKS = ARR_DELAY * TICKS_PER_SECOND / 1000;
+
+// Frames per row of gravity at 60 Hz for each level, starting at level 1.
+// Levels past the end of the table use the last entry.
+const int GRAVITY_FRAMES[] = { 30, 27, 24, 21, 18, 15, 12, 10, 8, 6, 5, 4, 3, 2, 1 };
+const int GRAVITY_LEVELS = sizeof(GRAVITY_FRAMES) / sizeof(GRAVITY_FRAMES[0]);
+
+// Garbage rows sent to the opponent by clearing 0, 1, 2, 3 and 4 lines at once
+const int GARBAGE_LINES[] = { 0, 0, 1, 2, 4 };
+// Color index of garbage cells, after the piece colors
+const int GARBAGE_COLOR = PIECE_COUNT + 1;
+
+// Buttons held during a tick, combined into an Input bit mask
+enum InputFlag : uint8_t {
+    INPUT_NONE = 0,
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_ROTATE = 1 << 2,
+    INPUT_SOFT_DROP = 1 << 3,
+    INPUT_HARD_DROP = 1 << 4
+};
+typedef uint8_t Input;
+
+// How the next piece is chosen
+enum Randomizer {
+    RANDOMIZER_UNIFORM, // each piece independently at random
+    RANDOMIZER_BAG      // each run of seven pieces is a shuffled set of all seven
+};
+
+// Points for a line clear
+enum ScoringRule {
+    SCORING_SQUARE,    // lines * lines * 100
+    SCORING_NES,       // 40, 100, 300, 1200 times the level
+    SCORING_GUIDELINE  // 100, 300, 500, 800 times the level
+};
+
+// When the level goes up
+enum LevelingRule {
+    LEVELING_TEN_LINES,     // every 10 lines
+    LEVELING_VARIABLE_GOAL, // after 5 * level lines in the level
+    LEVELING_NONE           // never
+};
+
+/**
+ * @brief Rule choices for a game. GameState::reset() leaves them alone.
+ */
+struct GameRules {
+    Randomizer randomizer = RANDOMIZER_UNIFORM;
+    ScoringRule scoring = SCORING_SQUARE;
+    LevelingRule leveling = LEVELING_TEN_LINES;
+};
+
+/**
+ * @brief Complete state of one game, independent of any window or renderer.
+ *
+ * The game advances one tick per call to step(). Moves, rotation and
+ * drops fire on the tick a button goes down; a hard drop moves the piece
+ * straight to its landing row and locks it. Holding left or right repeats the move
+ * after dasTicks and then every arrTicks; the other buttons do not
+ * repeat. After a lock that completes rows the game pauses for
+ * LINE_CLEAR_DELAY with the rows still on the board, so a front end can
+ * animate them.
+ *
+ * Pieces come from a PRNG owned by the state and seeded by reset(), so a
+ * game is fully determined by its seed, rules and inputs.
+ *
+ * In versus play, line clears add to outgoingGarbage after cancelling
+ * any incomingGarbage, and the match moves it to the other player's
+ * incomingGarbage. Queued garbage rises, with one hole in a column from
+ * its own PRNG, when a lock clears nothing. A single-player game never
+ * receives any.
+ *
+ * The state holds no pointers, so a copy is a complete snapshot.
+ */
+struct GameState {
+    Board board;
+    Tetromino current;
+    Tetromino next;
+    int score;
+    int level;
+    int linesCleared;     // lines cleared in the current level
+    int clearedRowsCount; // lines cleared in the whole game
+    int dropTicks;       // ticks per gravity drop at the current level
+    int dropTimer;       // ticks since the last gravity drop
+    Input heldInput;     // buttons held on the previous tick
+    RowMask pendingClear; // full rows waiting out the line clear delay
+    int clearTimer;      // ticks since pendingClear was set
+    bool gameOver;
+    uint64_t tick;
+    int pieceCount;      // pieces spawned so far, including the current one
+    int shiftTimer;      // ticks left or right has been held
+    uint64_t rngState;   // piece PRNG
+    uint8_t bag[PIECE_COUNT];
+    int bagIndex;        // next piece to take from the bag
+    int incomingGarbage; // garbage rows waiting for a lock that clears nothing
+    int outgoingGarbage; // garbage rows sent and not yet delivered
+    uint64_t garbageRngState; // garbage hole PRNG
+
+    // Settings; reset() leaves them alone
+    int dasTicks = DAS_TICKS;
+    int arrTicks = ARR_TICKS; // at least 1
+    GameRules rules;
+
+    void reset(uint64_t seed);
+    void step(Input input);
+
+    // Zobrist hash of the board and the current and next piece types
+    uint64_t positionHash() const {
+        return board.hash ^ activePieceKey(current.type) ^ nextPieceKey(next.type);
+    }
+
+private:
+    uint64_t nextRandom();
+    int randomPiece();
+    void shift(int dx);
+    void lockPiece();
+    void spawnNext();
+    void scoreLines(int lines);
+    void raiseGarbage();
+};
+
+/**
+ * @brief Tests whether the Tetromino fits on the board, without logging.
+ * This is the test checkCollision and rotateTetromino are built on.
+ */
+inline bool pieceFits(const Tetromino& tetromino, const Board& board) {
+    return !collides(board, pieceShape(tetromino).rows, PIECE_BOX_SIZE, tetromino.x, tetromino.y);
+}
+
+int gravityTicks(int level);
+int dropDistance(const Tetromino& tetromino, const Board& board);
+bool checkCollision(const Tetromino& tetromino, const Board& board);
+bool handleCollision(Tetromino& tetromino, Board& board);
+void rotateTetromino(Tetromino& tetromino, const Board& board, int direction = 1);
+bool isGameOver(const Tetromino& tetromino, const Board& board);
+RowMask getFullRows(const Board& board);
+int clearFullRows(Board& board, RowMask fullRows);
+void printBoard(const Board& board);
+
+#endif // GAME_H
@@ -0,0 +1,121 @@
+#include "input.h"
+
+using namespace std;
+
+
+/**
+ * @brief Appends an event. Called only by the producer.
+ *
+ * @return false if the ring is full and the event was dropped.
+ */
+bool InputRing::push(const InputEvent& event) {
+    uint32_t write = tail.load(memory_order_relaxed);
+    if (write - head.load(memory_order_acquire) == INPUT_RING_SIZE) {
+        return false;
+    }
+    events[write & (INPUT_RING_SIZE - 1)] = event;
+    tail.store(write + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Copies the oldest event without removing it. Called only by the consumer.
+ *
+ * @return false if the ring is empty.
+ */
+bool InputRing::peek(InputEvent& event) const {
+    uint32_t read = head.load(memory_order_relaxed);
+    if (read == tail.load(memory_order_acquire)) {
+        return false;
+    }
+    event = events[read & (INPUT_RING_SIZE - 1)];
+    return true;
+}
+
+/**
+ * @brief Removes the oldest event. Only valid after a successful peek().
+ */
+void InputRing::pop() {
+    head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+InputQueue::InputQueue() {
+    SDL_AddEventWatch(capture, this);
+}
+
+InputQueue::~InputQueue() {
+    SDL_DelEventWatch(capture, this);
+}
+
+/**
+ * @brief Lets SDL collect pending OS events, which runs the capture watch.
+ */
+void InputQueue::pump() {
+    SDL_PumpEvents();
+}
+
+/**
+ * @brief Applies the events captured up to a point in time to the buttons.
+ *
+ * @param time Performance counter value of the end of the tick being simulated.
+ * @param held The buttons currently held down.
+ * @param tapped Receives buttons pressed since the last tick, so a tap
+ * shorter than a tick is not lost.
+ * @return Uint64 The capture time of the earliest press applied, or 0 if
+ * no button went down.
+ */
+Uint64 InputQueue::applyUntil(Uint64 time, Input& held, Input& tapped) {
+    Uint64 firstPress = 0;
+    InputEvent event;
+    while (ring.peek(event) && event.timestamp <= time) {
+        ring.pop();
+        if (event.down) {
+            held |= event.button;
+            tapped |= event.button;
+            if (firstPress == 0) {
+                firstPress = event.timestamp;
+            }
+        } else {
+            held &= ~event.button;
+        }
+    }
+    return firstPress;
+}
+
+/**
+ * @brief Event watch that queues game key presses and releases.
+ *
+ * Key repeats from the OS are ignored; the game does its own auto-repeat.
+ */
+int SDLCALL InputQueue::capture(void* userdata, SDL_Event* event) {
+    if ((event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) || event->key.repeat != 0) {
+        return 0;
+    }
+    Input button = keyToInput(event->key.keysym.sym);
+    if (button == INPUT_NONE) {
+        return 0;
+    }
+    InputQueue* queue = static_cast<InputQueue*>(userdata);
+    InputEvent captured = { SDL_GetPerformanceCounter(), button, event->type == SDL_KEYDOWN };
+    if (!queue->ring.push(captured)) {
+        queue->dropped.fetch_add(1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a key to the game button it controls.
+ * 
+ * @param key The SDL key code.
+ * @return Input The button bit, or INPUT_NONE for unmapped keys.
+ */
+Input keyToInput(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_w: return INPUT_ROTATE;
+        case SDLK_d: return INPUT_RIGHT;
+        case SDLK_a: return INPUT_LEFT;
+        case SDLK_s: return INPUT_SOFT_DROP;
+        case SDLK_SPACE: return INPUT_HARD_DROP;
+        default: return INPUT_NONE;
+    }
+}
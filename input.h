@@ -0,0 +1,74 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL.h>
+#include <atomic>
+#include <cstdint>
+#include "game.h"
+
+const int INPUT_RING_SIZE = 256; // events; a power of two
+
+/**
+ * @brief A button going down or up, stamped with the performance counter
+ * value at which it was captured.
+ */
+struct InputEvent {
+    Uint64 timestamp;
+    Input button;
+    bool down;
+};
+
+/**
+ * @brief Fixed-size single-producer single-consumer queue of input events.
+ *
+ * One thread may push() while another peeks and pops, without locks. The
+ * read and write positions live on separate cache lines so the two sides
+ * do not contend.
+ */
+class InputRing {
+public:
+    bool push(const InputEvent& event);
+    bool peek(InputEvent& event) const;
+    void pop();
+
+private:
+    static_assert((INPUT_RING_SIZE & (INPUT_RING_SIZE - 1)) == 0, "The ring size must be a power of two");
+
+    InputEvent events[INPUT_RING_SIZE];
+    alignas(64) std::atomic<uint32_t> head{0}; // next event to read, advanced by the consumer
+    alignas(64) std::atomic<uint32_t> tail{0}; // next slot to write, advanced by the producer
+};
+
+/**
+ * @brief Captures key events the moment SDL receives them and hands them to
+ * the simulation in time order.
+ *
+ * An event watch stamps each key event with the high-resolution counter as
+ * SDL pumps it and pushes it into the ring. The game loop then applies
+ * the events tick by tick, so a key pressed between frames counts from
+ * the tick it happened in rather than the next frame. SDL only delivers
+ * events on the thread that owns the window, so pump() is also called
+ * while the loop waits for the next frame to capture events sooner.
+ */
+class InputQueue {
+public:
+    InputQueue();
+    ~InputQueue();
+
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    void pump();
+    Uint64 applyUntil(Uint64 time, Input& held, Input& tapped);
+    int droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static int SDLCALL capture(void* userdata, SDL_Event* event);
+
+    InputRing ring;
+    std::atomic<int> dropped{0};
+};
+
+Input keyToInput(SDL_Keycode key);
+
+#endif // INPUT_H
@@ -0,0 +1,111 @@
+#include "layers.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+
+RenderLayers::RenderLayers(SDL_Renderer* renderer, int width, int height)
+    : renderer(renderer) {
+    clearBoard(board);
+    invalidate();
+    if (!SDL_RenderTargetSupported(renderer)) {
+        cout << "Render targets not supported, drawing every frame in full" << endl;
+        return;
+    }
+    for (int i = 0; i < LAYER_COUNT; i++) {
+        textures[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (textures[i] == NULL) {
+            cout << "Failed to create layer texture! SDL_Error: " << SDL_GetError() << endl;
+            return;
+        }
+        SDL_SetTextureBlendMode(textures[i], SDL_BLENDMODE_BLEND);
+    }
+    valid = true;
+}
+
+RenderLayers::~RenderLayers() {
+    for (int i = 0; i < LAYER_COUNT; i++) {
+        if (textures[i] != NULL) {
+            SDL_DestroyTexture(textures[i]);
+        }
+    }
+}
+
+/**
+ * @brief Marks every layer for redrawing, e.g. after the renderer lost its targets.
+ */
+void RenderLayers::invalidate() {
+    for (int i = 0; i < LAYER_COUNT; i++) {
+        dirty[i] = true;
+    }
+}
+
+bool RenderLayers::beginChrome() {
+    return begin(LAYER_CHROME);
+}
+
+/**
+ * @brief Starts redrawing the board layer if the locked cells changed.
+ *
+ * @param board The board to draw.
+ * @return true if the caller should draw the board and then call end().
+ */
+bool RenderLayers::beginBoard(const Board& board) {
+    if (memcmp(&this->board, &board, sizeof(board)) != 0) {
+        this->board = board;
+        dirty[LAYER_BOARD] = true;
+    }
+    return begin(LAYER_BOARD);
+}
+
+/**
+ * @brief Starts redrawing the HUD layer if the score, level, next piece or
+ * game over state changed.
+ *
+ * @param state The game whose HUD is drawn.
+ * @return true if the caller should draw the HUD and then call end().
+ */
+bool RenderLayers::beginHud(const GameState& state) {
+    if (state.score != score || state.level != level || state.next.type != nextType || state.gameOver != gameOver) {
+        score = state.score;
+        level = state.level;
+        nextType = state.next.type;
+        gameOver = state.gameOver;
+        dirty[LAYER_HUD] = true;
+    }
+    return begin(LAYER_HUD);
+}
+
+bool RenderLayers::begin(LayerId layer) {
+    if (!valid || !dirty[layer]) {
+        return false;
+    }
+    dirty[layer] = false;
+    redraws++;
+    SDL_SetRenderTarget(renderer, textures[layer]);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    return true;
+}
+
+/**
+ * @brief Finishes redrawing a layer and points the renderer back at the window.
+ */
+void RenderLayers::end() {
+    SDL_SetRenderTarget(renderer, NULL);
+}
+
+/**
+ * @brief Copies every layer to the window, bottom layer first.
+ *
+ * @param stats Receives the draw calls made.
+ */
+void RenderLayers::composite(RenderStats& stats) {
+    for (int i = 0; i < LAYER_COUNT; i++) {
+        SDL_RenderCopy(renderer, textures[i], NULL, NULL);
+        stats.drawCalls++;
+        stats.vertices += 4;
+    }
+}
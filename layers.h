@@ -0,0 +1,61 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <SDL.h>
+#include "block_batch.h"
+#include "game.h"
+
+enum LayerId {
+    LAYER_CHROME, // side borders, next piece box and score panel background
+    LAYER_BOARD,  // locked cells
+    LAYER_HUD,    // score, level, next piece and game over text
+    LAYER_COUNT
+};
+
+/**
+ * @brief Persistent render-target textures for the parts of a frame that
+ * rarely change.
+ *
+ * Each layer remembers the inputs it was last drawn from. The begin*()
+ * calls compare the new inputs against them and, only when they differ,
+ * point the renderer at the layer's texture and return true so the caller
+ * can redraw it, followed by end(). composite() then copies every layer
+ * to the screen. An idle frame costs a clear, one copy per layer and the
+ * falling piece.
+ */
+class RenderLayers {
+public:
+    RenderLayers(SDL_Renderer* renderer, int width, int height);
+    ~RenderLayers();
+
+    RenderLayers(const RenderLayers&) = delete;
+    RenderLayers& operator=(const RenderLayers&) = delete;
+
+    bool isValid() const { return valid; }
+    int redrawCount() const { return redraws; }
+
+    void invalidate();
+    bool beginChrome();
+    bool beginBoard(const Board& board);
+    bool beginHud(const GameState& state);
+    void end();
+    void composite(RenderStats& stats);
+
+private:
+    bool begin(LayerId layer);
+
+    SDL_Renderer* renderer;
+    SDL_Texture* textures[LAYER_COUNT] = {};
+    bool dirty[LAYER_COUNT];
+    bool valid = false;
+    int redraws = 0;
+
+    // Inputs the layers were last drawn from
+    Board board;
+    int score = 0;
+    int level = 0;
+    int nextType = PIECE_NONE;
+    bool gameOver = false;
+};
+
+#endif // LAYERS_H
@@ -0,0 +1,292 @@
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @brief One queued record. Text is formatted by the caller straight into
+ * the slot; boards are packed into it.
+ */
+struct LogRecord {
+    uint64_t time;   // nanoseconds since logStart()
+    uint8_t level;
+    bool board;      // payload is a packed board rather than text
+    uint16_t length;
+    char payload[LOG_PAYLOAD_SIZE];
+};
+
+/**
+ * @brief Bounded multi-producer single-consumer queue of records.
+ *
+ * Each slot carries a sequence number that says whether it is free for
+ * the producer at a given position or holds a record for the consumer at
+ * it, so producers claim slots with one compare-and-swap and never wait.
+ * When the queue is full the record is dropped and counted instead.
+ */
+struct LogQueue {
+    struct Slot {
+        atomic<uint64_t> sequence;
+        LogRecord record;
+    };
+
+    Slot slots[LOG_QUEUE_SIZE];
+    alignas(64) atomic<uint64_t> enqueuePos{0};
+    alignas(64) uint64_t dequeuePos = 0; // used by the writer thread only
+    atomic<uint64_t> dropped{0};
+
+    LogQueue() {
+        for (int i = 0; i < LOG_QUEUE_SIZE; i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Claims the next free slot, or returns NULL if the queue is full.
+     * The caller fills the record and then calls publish().
+     */
+    Slot* claim() {
+        uint64_t pos = enqueuePos.load(memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & (LOG_QUEUE_SIZE - 1)];
+            int64_t diff = int64_t(slot.sequence.load(memory_order_acquire)) - int64_t(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                dropped.fetch_add(1, memory_order_relaxed);
+                return NULL;
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(Slot* slot) {
+        uint64_t pos = slot->sequence.load(memory_order_relaxed);
+        slot->sequence.store(pos + 1, memory_order_release);
+    }
+
+    /**
+     * @brief Hands the oldest record to the writer, if one is ready.
+     */
+    bool pop(LogRecord& record) {
+        Slot& slot = slots[dequeuePos & (LOG_QUEUE_SIZE - 1)];
+        if (slot.sequence.load(memory_order_acquire) != dequeuePos + 1) {
+            return false;
+        }
+        record = slot.record;
+        slot.sequence.store(dequeuePos + LOG_QUEUE_SIZE, memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+};
+
+static LogQueue queue;
+static atomic<bool> running{false};
+static atomic<bool> stopping{false};
+// Producers between their running check and the publish of their record
+static atomic<int> activeProducers{0};
+static thread writer;
+static FILE* textOut = NULL;
+static FILE* boardOut = NULL;
+static chrono::steady_clock::time_point startTime;
+
+/**
+ * @brief Marks a producer as active for its lifetime, so logStop() waits
+ * for its record to be published before stopping the writer.
+ *
+ * The count is raised before running is read, and logStop() clears
+ * running before reading the count, both sequentially consistent: either
+ * the producer sees the log stopped, or logStop() sees the producer.
+ */
+struct ProducerScope {
+    bool accepted;
+
+    ProducerScope() {
+        activeProducers.fetch_add(1);
+        accepted = running.load();
+    }
+    ~ProducerScope() {
+        activeProducers.fetch_sub(1, memory_order_release);
+    }
+};
+
+static const char* const LEVEL_NAMES[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+static uint64_t elapsedNanoseconds() {
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count());
+}
+
+/**
+ * @brief Writes one record. Board dumps go to the binary output as the
+ * timestamp followed by the packed board, with a line in the text output
+ * giving their index.
+ */
+static void writeRecord(const LogRecord& record, uint64_t& boardIndex) {
+    double seconds = record.time / 1e9;
+    const char* level = LEVEL_NAMES[record.level];
+    if (!record.board) {
+        fprintf(textOut, "%.6f [%s] %.*s\n", seconds, level, int(record.length), record.payload);
+        return;
+    }
+    if (boardOut != NULL) {
+        fwrite(&record.time, sizeof(record.time), 1, boardOut);
+        fwrite(record.payload, 1, record.length, boardOut);
+    }
+    fprintf(textOut, "%.6f [%s] board #%llu\n", seconds, level, static_cast<unsigned long long>(boardIndex));
+    boardIndex++;
+}
+
+/**
+ * @brief Writer thread: drains the queue in batches and flushes once per
+ * batch, sleeping briefly when there is nothing to write.
+ */
+static void writerLoop() {
+    LogRecord record;
+    uint64_t boardIndex = 0;
+    for (;;) {
+        bool wrote = false;
+        while (queue.pop(record)) {
+            writeRecord(record, boardIndex);
+            wrote = true;
+        }
+        if (wrote) {
+            fflush(textOut);
+            if (boardOut != NULL) {
+                fflush(boardOut);
+            }
+        } else if (stopping.load(memory_order_acquire)) {
+            return;
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+    }
+}
+
+void logStart(FILE* text, FILE* boards) {
+    if (running.load()) {
+        return;
+    }
+    textOut = text;
+    boardOut = boards;
+    startTime = chrono::steady_clock::now();
+    stopping.store(false);
+    writer = thread(writerLoop);
+    running.store(true, memory_order_release);
+}
+
+/**
+ * @brief Stops accepting records, waits for records being queued, writes
+ * out what is queued and joins the writer.
+ */
+void logStop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    while (activeProducers.load(memory_order_acquire) != 0) {
+        this_thread::yield();
+    }
+    stopping.store(true, memory_order_release);
+    writer.join();
+}
+
+/**
+ * @brief The number of records discarded because the queue was full.
+ */
+uint64_t logDroppedCount() {
+    return queue.dropped.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Queues a printf-style text record. Use the LOG_* macros so
+ * disabled levels compile to nothing.
+ *
+ * Text longer than a record's payload is truncated.
+ */
+void logMessage(int level, const char* format, ...) {
+    ProducerScope producer;
+    if (!producer.accepted) {
+        return;
+    }
+    LogQueue::Slot* slot = queue.claim();
+    if (slot == NULL) {
+        return;
+    }
+    LogRecord& record = slot->record;
+    record.time = elapsedNanoseconds();
+    record.level = uint8_t(level);
+    record.board = false;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record.payload, LOG_PAYLOAD_SIZE, format, args);
+    va_end(args);
+    record.length = uint16_t(length < 0 ? 0 : min(length, LOG_PAYLOAD_SIZE - 1));
+    queue.publish(slot);
+}
+
+/**
+ * @brief Queues a dump of the board in packed form.
+ */
+void logBoard(int level, const Board& board) {
+    ProducerScope producer;
+    if (!producer.accepted) {
+        return;
+    }
+    LogQueue::Slot* slot = queue.claim();
+    if (slot == NULL) {
+        return;
+    }
+    LogRecord& record = slot->record;
+    record.time = elapsedNanoseconds();
+    record.level = uint8_t(level);
+    record.board = true;
+    record.length = uint16_t(packBoard(board, reinterpret_cast<uint8_t*>(record.payload)));
+    queue.publish(slot);
+}
+
+/**
+ * @brief Packs a board into PACKED_BOARD_SIZE bytes: the row bits as
+ * little-endian words of sizeof(RowBits) bytes, then the colors two cells per byte, low
+ * nibble first.
+ *
+ * @return int The number of bytes written.
+ */
+int packBoard(const Board& board, uint8_t* out) {
+    uint8_t* p = out;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (size_t i = 0; i < sizeof(RowBits); i++) {
+            *p++ = uint8_t(uint64_t(board.rows[y]) >> (8 * i));
+        }
+    }
+    const uint8_t* colors = &board.colors[0][0];
+    for (int i = 0; i < BOARD_HEIGHT * BOARD_WIDTH; i += 2) {
+        uint8_t high = i + 1 < BOARD_HEIGHT * BOARD_WIDTH ? colors[i + 1] : 0;
+        *p++ = uint8_t((colors[i] & 0x0F) | (high << 4));
+    }
+    return int(p - out);
+}
+
+/**
+ * @brief Restores a board written by packBoard().
+ */
+void unpackBoard(const uint8_t* data, Board& board) {
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        uint64_t row = 0;
+        for (size_t i = 0; i < sizeof(RowBits); i++) {
+            row |= uint64_t(*data++) << (8 * i);
+        }
+        board.rows[y] = RowBits(row);
+    }
+    uint8_t* colors = &board.colors[0][0];
+    for (int i = 0; i < BOARD_HEIGHT * BOARD_WIDTH; i++) {
+        colors[i] = (i % 2 == 0) ? (data[i / 2] & 0x0F) : (data[i / 2] >> 4);
+    }
+    rebuildBoardIndex(board);
+}
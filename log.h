@@ -0,0 +1,85 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include "board.h"
+
+// Log levels, lowest first. Usable in #if, so they are macros.
+#define TETRIS_LOG_TRACE 0
+#define TETRIS_LOG_DEBUG 1
+#define TETRIS_LOG_INFO 2
+#define TETRIS_LOG_WARN 3
+#define TETRIS_LOG_ERROR 4
+#define TETRIS_LOG_OFF 5
+
+// Records below TETRIS_LOG_LEVEL are compiled out entirely, arguments
+// included. Set it with -DTETRIS_LOG_LEVEL=TETRIS_LOG_<LEVEL>.
+#ifndef TETRIS_LOG_LEVEL
+#ifdef NDEBUG
+#define TETRIS_LOG_LEVEL TETRIS_LOG_INFO
+#else
+#define TETRIS_LOG_LEVEL TETRIS_LOG_DEBUG
+#endif
+#endif
+
+const int LOG_QUEUE_SIZE = 1024;   // records; a power of two
+const int PACKED_BOARD_SIZE = BOARD_HEIGHT * int(sizeof(RowBits)) + (BOARD_HEIGHT * BOARD_WIDTH + 1) / 2;
+// Bytes of text or packed board per record; grown for large boards so a packed board fits
+const int LOG_PAYLOAD_SIZE = PACKED_BOARD_SIZE > 192 ? PACKED_BOARD_SIZE : 192;
+
+/**
+ * @brief Starts the background writer. Until this is called, and after
+ * logStop(), records are discarded.
+ *
+ * @param text Receives text records, one line each.
+ * @param boards Receives board dumps in packed binary form, or NULL to
+ * only note them in the text output.
+ */
+void logStart(FILE* text, FILE* boards = NULL);
+void logStop();
+uint64_t logDroppedCount();
+
+void logMessage(int level, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+void logBoard(int level, const Board& board);
+
+int packBoard(const Board& board, uint8_t* out);
+void unpackBoard(const uint8_t* data, Board& board);
+
+#if TETRIS_LOG_LEVEL <= TETRIS_LOG_TRACE
+#define LOG_TRACE(...) logMessage(TETRIS_LOG_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if TETRIS_LOG_LEVEL <= TETRIS_LOG_DEBUG
+#define LOG_DEBUG(...) logMessage(TETRIS_LOG_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_BOARD(board) logBoard(TETRIS_LOG_DEBUG, board)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#define LOG_DEBUG_BOARD(board) ((void)0)
+#endif
+
+#if TETRIS_LOG_LEVEL <= TETRIS_LOG_INFO
+#define LOG_INFO(...) logMessage(TETRIS_LOG_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if TETRIS_LOG_LEVEL <= TETRIS_LOG_WARN
+#define LOG_WARN(...) logMessage(TETRIS_LOG_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if TETRIS_LOG_LEVEL <= TETRIS_LOG_ERROR
+#define LOG_ERROR(...) logMessage(TETRIS_LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif // LOG_H
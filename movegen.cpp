@@ -0,0 +1,194 @@
+#include "movegen.h"
+#include "bot.h"
+
+#include <atomic>
+
+using namespace std;
+
+const int STATE_WORDS = (PIECE_STATE_COUNT + 63) / 64;
+
+struct CanonicalRotations {
+    int8_t rotation[PIECE_COUNT][ROTATION_COUNT];
+};
+
+/**
+ * @brief Maps each rotation state to the first rotation of the same piece
+ * with the same cells, so an O, or an I, S or Z turned half way round,
+ * locked in the same cells counts as one placement. Evaluated at compile time.
+ */
+constexpr CanonicalRotations buildCanonicalRotations() {
+    CanonicalRotations table{};
+    for (int type = 0; type < PIECE_COUNT; type++) {
+        for (int rotation = 0; rotation < ROTATION_COUNT; rotation++) {
+            const PieceShape& shape = PIECE_TABLE.shapes[type][rotation];
+            table.rotation[type][rotation] = int8_t(rotation);
+            for (int other = 0; other < rotation; other++) {
+                const PieceShape& candidate = PIECE_TABLE.shapes[type][other];
+                bool same = candidate.width == shape.width && candidate.height == shape.height;
+                for (int y = 0; same && y < shape.height; y++) {
+                    same = (shape.rows[shape.minY + y] >> shape.minX) == (candidate.rows[candidate.minY + y] >> candidate.minX);
+                }
+                if (same) {
+                    table.rotation[type][rotation] = int8_t(other);
+                    break;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr CanonicalRotations CANONICAL_ROTATIONS = buildCanonicalRotations();
+
+// Index of a piece that fits on the board, from its rotation and the
+// board cell at the top left of its cells' bounding box
+static int stateIndex(const Tetromino& tetromino, int rotation) {
+    const PieceShape& shape = pieceShape(tetromino);
+    return (rotation * BOARD_HEIGHT + tetromino.y + shape.minY) * BOARD_WIDTH + tetromino.x + shape.minX;
+}
+
+static Tetromino stateAt(int type, int index) {
+    Tetromino tetromino;
+    tetromino.type = type;
+    tetromino.rotation = index / (BOARD_WIDTH * BOARD_HEIGHT);
+    const PieceShape& shape = pieceShape(type, tetromino.rotation);
+    tetromino.x = index % BOARD_WIDTH - shape.minX;
+    tetromino.y = index / BOARD_WIDTH % BOARD_HEIGHT - shape.minY;
+    return tetromino;
+}
+
+static bool testAndSet(uint64_t* bits, int index) {
+    uint64_t mask = uint64_t(1) << (index & 63);
+    bool set = (bits[index >> 6] & mask) != 0;
+    bits[index >> 6] |= mask;
+    return set;
+}
+
+/**
+ * @brief Identifies the cells a locked piece covers: two placements of
+ * the same piece type have the same index exactly when they cover the
+ * same cells.
+ *
+ * @param placement A piece that fits on the board.
+ * @return int An index below PIECE_STATE_COUNT.
+ */
+int placementIndex(const Tetromino& placement) {
+    return stateIndex(placement, CANONICAL_ROTATIONS.rotation[placement.type][placement.rotation]);
+}
+
+/**
+ * @brief Lists every distinct lock position of a piece reachable from
+ * its spawn position with the game's own moves.
+ *
+ * A breadth-first search over (x, y, rotation) from the spawn position
+ * applies the moves step() allows: one column left or right, a clockwise
+ * rotation with its wall kicks, and a soft drop. Each state is queued
+ * once, tracked in a visited bitset. A state the piece cannot drop out
+ * of is where it locks. Unlike findPlacements, which only rotates at the
+ * spawn position and drops straight down, this finds the pieces slid
+ * under overhangs (tucks) and kicked into place by a rotation (spins).
+ *
+ * @param board The game board.
+ * @param type The piece type.
+ * @param placements Receives up to MAX_REACHABLE_PLACEMENTS locked
+ * pieces, in the order the search reaches them.
+ * @return int The number of placements found, 0 if the piece cannot spawn.
+ */
+int findReachablePlacements(const Board& board, int type, Tetromino* placements) {
+    Tetromino spawn = spawnTetromino(type);
+    if (!pieceFits(spawn, board)) {
+        return 0;
+    }
+
+    uint64_t visited[STATE_WORDS] = {};
+    uint64_t locked[STATE_WORDS] = {};
+    uint16_t queue[PIECE_STATE_COUNT];
+    int head = 0;
+    int tail = 0;
+    auto visit = [&](const Tetromino& tetromino) {
+        int index = stateIndex(tetromino, tetromino.rotation);
+        if (!testAndSet(visited, index)) {
+            queue[tail++] = uint16_t(index);
+        }
+    };
+    visit(spawn);
+
+    int count = 0;
+    while (head < tail) {
+        Tetromino piece = stateAt(type, queue[head++]);
+        Tetromino moved = piece;
+        for (int dx = -1; dx <= 1; dx += 2) {
+            moved.x = piece.x + dx;
+            if (pieceFits(moved, board)) {
+                visit(moved);
+            }
+        }
+        moved = piece;
+        rotateTetromino(moved, board);
+        if (moved.rotation != piece.rotation) {
+            visit(moved);
+        }
+        moved = piece;
+        moved.y += 1;
+        if (pieceFits(moved, board)) {
+            visit(moved);
+        } else if (!testAndSet(locked, placementIndex(piece))) {
+            placements[count++] = piece;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Counts the sequences of placements of the given pieces, like
+ * perft in chess: every reachable placement of the first piece, then on
+ * each resulting board every placement of the second, and so on.
+ *
+ * Full rows are cleared after each placement. A piece that cannot spawn
+ * ends its sequence early, which is not counted.
+ *
+ * @param board The starting board.
+ * @param pieces The piece types, in order; at least depth of them.
+ * @param depth The pieces placed per sequence.
+ * @return uint64_t The number of sequences, the leaves of the search.
+ */
+uint64_t perft(const Board& board, const int* pieces, int depth) {
+    if (depth <= 0) {
+        return 1;
+    }
+    Tetromino placements[MAX_REACHABLE_PLACEMENTS];
+    int count = findReachablePlacements(board, pieces[0], placements);
+    if (depth == 1) {
+        return uint64_t(count);
+    }
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; i++) {
+        Board child = board;
+        applyPlacement(child, placements[i]);
+        nodes += perft(child, pieces + 1, depth - 1);
+    }
+    return nodes;
+}
+
+/**
+ * @brief perft() with the placements of the first piece split across a
+ * thread pool, one task each.
+ */
+uint64_t perftSplit(const Board& board, const int* pieces, int depth, WorkStealingPool& pool) {
+    if (depth <= 1) {
+        return perft(board, pieces, depth);
+    }
+    Tetromino roots[MAX_REACHABLE_PLACEMENTS];
+    int rootCount = findReachablePlacements(board, pieces[0], roots);
+    atomic<uint64_t> nodes(0);
+    TaskGroup group;
+    for (int i = 0; i < rootCount; i++) {
+        pool.submit(group, [&, i] {
+            Board child = board;
+            applyPlacement(child, roots[i]);
+            nodes.fetch_add(perft(child, pieces + 1, depth - 1), memory_order_relaxed);
+        });
+    }
+    pool.wait(group);
+    return nodes.load();
+}
@@ -0,0 +1,19 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <cstdint>
+#include "game.h"
+#include "thread_pool.h"
+
+// States of a piece on the board: every rotation with its bounding box
+// at every column and row. Also the most lock positions a piece can have.
+const int PIECE_STATE_COUNT = ROTATION_COUNT * BOARD_WIDTH * BOARD_HEIGHT;
+const int MAX_REACHABLE_PLACEMENTS = PIECE_STATE_COUNT;
+static_assert(PIECE_STATE_COUNT <= 65536, "Piece states are queued as 16-bit indices");
+
+int placementIndex(const Tetromino& placement);
+int findReachablePlacements(const Board& board, int type, Tetromino* placements);
+uint64_t perft(const Board& board, const int* pieces, int depth);
+uint64_t perftSplit(const Board& board, const int* pieces, int depth, WorkStealingPool& pool);
+
+#endif // MOVEGEN_H
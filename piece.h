@@ -0,0 +1,192 @@
+#ifndef PIECE_H
+#define PIECE_H
+
+#include <cstdint>
+#include "board.h"
+
+// Piece types, in the order of their color indices
+enum PieceType {
+    PIECE_NONE = -1,
+    PIECE_I,
+    PIECE_J,
+    PIECE_L,
+    PIECE_O,
+    PIECE_S,
+    PIECE_T,
+    PIECE_Z,
+    PIECE_COUNT
+};
+
+const int ROTATION_COUNT = 4;
+const int PIECE_BOX_SIZE = 4;
+const int KICK_COUNT = 5;
+// Most landing spots a piece can have: one per column in each rotation
+const int MAX_PLACEMENTS = ROTATION_COUNT * BOARD_WIDTH;
+
+/**
+ * @brief A falling piece. The shape is looked up from the rotation tables,
+ * so copying, moving and rotating a piece never allocates.
+ */
+struct Tetromino {
+    int type = PIECE_NONE;
+    int rotation = 0;
+    int x = 0, y = 0;
+};
+
+struct PieceCell {
+    int8_t x, y;
+};
+
+/**
+ * @brief One rotation state of a piece inside its 4x4 box.
+ *
+ * `rows` holds a bit mask per box row for collision tests and `cells` the
+ * four occupied cells for drawing. minX/minY/width/height give the bounds
+ * of the cells within the box. `bottoms` holds, per box column, the row
+ * just below the column's lowest cell, or 0 for an empty column; it is
+ * what lands on the board's skyline.
+ */
+struct PieceShape {
+    PieceRowBits rows[PIECE_BOX_SIZE];
+    PieceCell cells[4];
+    int8_t minX, minY, width, height;
+    int8_t bottoms[PIECE_BOX_SIZE];
+};
+
+struct PieceTable {
+    PieceShape shapes[PIECE_COUNT][ROTATION_COUNT];
+};
+
+// Spawn-state cells and rotation box size of each piece (SRS orientation)
+constexpr PieceCell SPAWN_CELLS[PIECE_COUNT][4] = {
+    {{ 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 1 }}, // I
+    {{ 0, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }}, // J
+    {{ 2, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }}, // L
+    {{ 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }}, // O
+    {{ 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 }}, // S
+    {{ 1, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }}, // T
+    {{ 0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 }}  // Z
+};
+constexpr int ROTATION_BOX_SIZE[PIECE_COUNT] = { 4, 3, 3, 2, 3, 3, 3 };
+
+/**
+ * @brief Builds every rotation state by turning the spawn cells clockwise
+ * inside the piece's rotation box. Evaluated at compile time.
+ */
+constexpr PieceTable buildPieceTable() {
+    PieceTable table{};
+    for (int type = 0; type < PIECE_COUNT; type++) {
+        int n = ROTATION_BOX_SIZE[type];
+        PieceCell cells[4] = {};
+        for (int i = 0; i < 4; i++) {
+            cells[i] = SPAWN_CELLS[type][i];
+        }
+        for (int rotation = 0; rotation < ROTATION_COUNT; rotation++) {
+            PieceShape& shape = table.shapes[type][rotation];
+            int minX = PIECE_BOX_SIZE, minY = PIECE_BOX_SIZE, maxX = 0, maxY = 0;
+            for (int i = 0; i < 4; i++) {
+                shape.cells[i] = cells[i];
+                shape.rows[cells[i].y] |= PieceRowBits(1u << cells[i].x);
+                if (shape.bottoms[cells[i].x] < cells[i].y + 1) {
+                    shape.bottoms[cells[i].x] = int8_t(cells[i].y + 1);
+                }
+                minX = cells[i].x < minX ? cells[i].x : minX;
+                minY = cells[i].y < minY ? cells[i].y : minY;
+                maxX = cells[i].x > maxX ? cells[i].x : maxX;
+                maxY = cells[i].y > maxY ? cells[i].y : maxY;
+            }
+            shape.minX = int8_t(minX);
+            shape.minY = int8_t(minY);
+            shape.width = int8_t(maxX - minX + 1);
+            shape.height = int8_t(maxY - minY + 1);
+
+            // Rotate clockwise: (x, y) -> (n - 1 - y, x)
+            for (int i = 0; i < 4; i++) {
+                PieceCell cell = cells[i];
+                cells[i] = { int8_t(n - 1 - cell.y), cell.x };
+            }
+        }
+    }
+    return table;
+}
+
+constexpr PieceTable PIECE_TABLE = buildPieceTable();
+
+/**
+ * SRS wall kick offsets, tried in order until one fits. Indexed by the
+ * rotation being left; offsets use SRS convention (+y is up), so the
+ * y component is subtracted from the board row.
+ */
+constexpr int8_t KICKS_JLSTZ_CW[ROTATION_COUNT][KICK_COUNT][2] = {
+    {{ 0, 0 }, { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 }}, // 0 -> R
+    {{ 0, 0 }, { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 }},     // R -> 2
+    {{ 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 }},    // 2 -> L
+    {{ 0, 0 }, { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 }}   // L -> 0
+};
+constexpr int8_t KICKS_JLSTZ_CCW[ROTATION_COUNT][KICK_COUNT][2] = {
+    {{ 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 }},    // 0 -> L
+    {{ 0, 0 }, { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 }},     // R -> 0
+    {{ 0, 0 }, { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 }}, // 2 -> R
+    {{ 0, 0 }, { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 }}   // L -> 2
+};
+constexpr int8_t KICKS_I_CW[ROTATION_COUNT][KICK_COUNT][2] = {
+    {{ 0, 0 }, { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 }},   // 0 -> R
+    {{ 0, 0 }, { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 }},   // R -> 2
+    {{ 0, 0 }, { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 }},   // 2 -> L
+    {{ 0, 0 }, { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 }}    // L -> 0
+};
+constexpr int8_t KICKS_I_CCW[ROTATION_COUNT][KICK_COUNT][2] = {
+    {{ 0, 0 }, { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 }},   // 0 -> L
+    {{ 0, 0 }, { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 }},   // R -> 0
+    {{ 0, 0 }, { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 }},   // 2 -> R
+    {{ 0, 0 }, { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 }}    // L -> 2
+};
+
+inline const PieceShape& pieceShape(int type, int rotation) {
+    return PIECE_TABLE.shapes[type][rotation];
+}
+
+inline const PieceShape& pieceShape(const Tetromino& tetromino) {
+    return PIECE_TABLE.shapes[tetromino.type][tetromino.rotation];
+}
+
+inline int pieceColor(int type) {
+    return type + 1;
+}
+
+/**
+ * @brief Returns the kick offsets for rotating a piece out of `rotation`.
+ *
+ * @param type The piece type.
+ * @param rotation The rotation state being left.
+ * @param direction 1 for clockwise, -1 for counter-clockwise.
+ */
+inline const int8_t (*wallKicks(int type, int rotation, int direction))[2] {
+    if (type == PIECE_I) {
+        return direction > 0 ? KICKS_I_CW[rotation] : KICKS_I_CCW[rotation];
+    }
+    return direction > 0 ? KICKS_JLSTZ_CW[rotation] : KICKS_JLSTZ_CCW[rotation];
+}
+
+// Zobrist keys of the piece being placed and of the preview piece,
+// numbered after the board's cell keys
+constexpr uint64_t activePieceKey(int type) {
+    return zobristKey(uint64_t(BOARD_HEIGHT * BOARD_WIDTH + type));
+}
+
+constexpr uint64_t nextPieceKey(int type) {
+    return zobristKey(uint64_t(BOARD_HEIGHT * BOARD_WIDTH + PIECE_COUNT + type));
+}
+
+// A new piece, its rotation box centered on the board (left of center
+// when the two cannot be centered exactly)
+inline Tetromino spawnTetromino(int type, int boardWidth = BOARD_WIDTH) {
+    Tetromino tetromino;
+    tetromino.type = type;
+    tetromino.rotation = 0;
+    tetromino.x = (boardWidth - ROTATION_BOX_SIZE[type]) / 2;
+    tetromino.y = 0;
+    return tetromino;
+}
+
+#endif // PIECE_H
@@ -0,0 +1,307 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "frame", "events", "step", "gravity", "line_clear", "display", "text", "present", "bot", "rollback"
+};
+
+struct TraceEvent {
+    uint64_t start; // nanoseconds since the profiler's epoch
+    uint32_t duration;
+    uint32_t phase;
+};
+
+/**
+ * @brief Histograms and recent events of one thread.
+ *
+ * Only the owning thread writes, so updates are plain relaxed loads and
+ * stores with no read-modify-write; other threads may read at any time
+ * and see slightly stale counts.
+ */
+struct ThreadProfile {
+    int index;
+    atomic<uint64_t> buckets[PHASE_COUNT][PROFILE_BUCKETS];
+    atomic<uint64_t> totalNs[PHASE_COUNT];
+    atomic<uint64_t> maxNs[PHASE_COUNT];
+    unique_ptr<TraceEvent[]> trace; // PROFILE_TRACE_EVENTS, or null when no trace was asked for
+    atomic<uint64_t> traceCount{0};
+
+    ThreadProfile(int index, bool keepTrace) : index(index) {
+        if (keepTrace) {
+            trace.reset(new TraceEvent[PROFILE_TRACE_EVENTS]);
+        }
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            for (int i = 0; i < PROFILE_BUCKETS; i++) {
+                buckets[phase][i].store(0, memory_order_relaxed);
+            }
+            totalNs[phase].store(0, memory_order_relaxed);
+            maxNs[phase].store(0, memory_order_relaxed);
+        }
+    }
+};
+
+static atomic<bool> enabled{false};
+static atomic<bool> tracing{false};
+static atomic<ThreadProfile*> profiles[PROFILE_MAX_THREADS];
+static atomic<int> profileCount{0};
+static thread_local ThreadProfile* localProfile = nullptr;
+static thread_local bool localRegistered = false;
+static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+static inline void increment(atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Index of the highest set bit; bits must be non-zero
+static inline int highestBit(uint64_t bits) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(bits);
+#else
+    int index = 0;
+    while (bits >>= 1) {
+        index++;
+    }
+    return index;
+#endif
+}
+
+static int bucketIndex(uint64_t ns) {
+    if (ns < PROFILE_SUB_BUCKETS) {
+        return int(ns);
+    }
+    int msb = highestBit(ns);
+    int sub = int((ns >> (msb - 3)) & (PROFILE_SUB_BUCKETS - 1));
+    int index = (msb - 2) * PROFILE_SUB_BUCKETS + sub;
+    return index < PROFILE_BUCKETS ? index : PROFILE_BUCKETS - 1;
+}
+
+// Midpoint of a bucket's range, in nanoseconds
+static double bucketValue(int index) {
+    if (index < PROFILE_SUB_BUCKETS) {
+        return index;
+    }
+    int msb = index / PROFILE_SUB_BUCKETS + 2;
+    int sub = index % PROFILE_SUB_BUCKETS;
+    double width = double(uint64_t(1) << (msb - 3));
+    return (PROFILE_SUB_BUCKETS + sub) * width + width / 2;
+}
+
+/**
+ * @brief Returns this thread's profile, registering it on first use.
+ * Returns nullptr once PROFILE_MAX_THREADS threads have registered.
+ */
+static ThreadProfile* threadProfile() {
+    if (!localRegistered) {
+        localRegistered = true;
+        int index = profileCount.fetch_add(1);
+        if (index < PROFILE_MAX_THREADS) {
+            localProfile = new ThreadProfile(index, tracing.load(memory_order_relaxed));
+            profiles[index].store(localProfile, memory_order_release);
+        }
+    }
+    return localProfile;
+}
+
+/**
+ * @brief Turns profiling on or off. Nothing is allocated until a thread
+ * first records a phase while it is on.
+ *
+ * @param enable Whether ProfileScope records.
+ * @param keepTrace Also keep each thread's recent events for a Chrome
+ * trace export. Only threads that start recording afterwards keep them,
+ * so ask for it with the first call.
+ */
+void profileEnable(bool enable, bool keepTrace) {
+    if (keepTrace) {
+        tracing.store(true, memory_order_relaxed);
+    }
+    enabled.store(enable, memory_order_relaxed);
+}
+
+bool profileEnabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Nanoseconds on the steady clock since the profiler was loaded.
+ */
+uint64_t profileNow() {
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count());
+}
+
+/**
+ * @brief Adds one timed phase to the calling thread's histogram and trace.
+ */
+void profileRecord(ProfilePhase phase, uint64_t start, uint64_t end) {
+    ThreadProfile* profile = threadProfile();
+    if (profile == nullptr) {
+        return;
+    }
+    uint64_t ns = end - start;
+    increment(profile->buckets[phase][bucketIndex(ns)], 1);
+    increment(profile->totalNs[phase], ns);
+    if (ns > profile->maxNs[phase].load(memory_order_relaxed)) {
+        profile->maxNs[phase].store(ns, memory_order_relaxed);
+    }
+
+    if (!profile->trace) {
+        return;
+    }
+    uint64_t count = profile->traceCount.load(memory_order_relaxed);
+    TraceEvent& event = profile->trace[count & (PROFILE_TRACE_EVENTS - 1)];
+    event.start = start;
+    event.duration = uint32_t(ns < UINT32_MAX ? ns : UINT32_MAX);
+    event.phase = uint32_t(phase);
+    profile->traceCount.store(count + 1, memory_order_release);
+}
+
+static void addThread(const ThreadProfile& profile, ProfileSnapshot& snapshot) {
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        for (int i = 0; i < PROFILE_BUCKETS; i++) {
+            snapshot.buckets[phase][i] += profile.buckets[phase][i].load(memory_order_relaxed);
+        }
+        snapshot.totalNs[phase] += profile.totalNs[phase].load(memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Sums every thread's histograms so far.
+ */
+void profileSnapshot(ProfileSnapshot& snapshot) {
+    memset(&snapshot, 0, sizeof(snapshot));
+    int count = profileCount.load() < PROFILE_MAX_THREADS ? profileCount.load() : PROFILE_MAX_THREADS;
+    for (int i = 0; i < count; i++) {
+        ThreadProfile* profile = profiles[i].load(memory_order_acquire);
+        if (profile != nullptr) {
+            addThread(*profile, snapshot);
+        }
+    }
+}
+
+/**
+ * @brief Summarizes the durations recorded for a phase between two snapshots.
+ *
+ * The percentiles and the maximum are bucket midpoints.
+ *
+ * @param now The later snapshot.
+ * @param before The earlier snapshot, or an all-zero one for everything so far.
+ * @param phase The phase to summarize.
+ */
+PhaseSummary summarizePhase(const ProfileSnapshot& now, const ProfileSnapshot& before, int phase) {
+    PhaseSummary summary;
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        summary.count += now.buckets[phase][i] - before.buckets[phase][i];
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.mean = (now.totalNs[phase] - before.totalNs[phase]) / 1000.0 / summary.count;
+
+    uint64_t p50Rank = (summary.count + 1) / 2;
+    uint64_t p99Rank = summary.count - summary.count / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < PROFILE_BUCKETS; i++) {
+        uint64_t inBucket = now.buckets[phase][i] - before.buckets[phase][i];
+        if (inBucket == 0) {
+            continue;
+        }
+        if (seen < p50Rank && seen + inBucket >= p50Rank) {
+            summary.p50 = bucketValue(i) / 1000.0;
+        }
+        if (seen < p99Rank && seen + inBucket >= p99Rank) {
+            summary.p99 = bucketValue(i) / 1000.0;
+        }
+        seen += inBucket;
+        summary.max = bucketValue(i) / 1000.0;
+    }
+    return summary;
+}
+
+/**
+ * @brief Writes one row per thread and phase: count, mean, p50, p99 and
+ * the exact maximum in microseconds.
+ */
+static void exportCsv(FILE* out, int threadCount) {
+    unique_ptr<ProfileSnapshot> zero(new ProfileSnapshot());
+    unique_ptr<ProfileSnapshot> single(new ProfileSnapshot());
+    fprintf(out, "thread,phase,count,mean_us,p50_us,p99_us,max_us\n");
+    for (int i = 0; i < threadCount; i++) {
+        ThreadProfile* profile = profiles[i].load(memory_order_acquire);
+        if (profile == nullptr) {
+            continue;
+        }
+        memset(single.get(), 0, sizeof(ProfileSnapshot));
+        addThread(*profile, *single);
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            PhaseSummary summary = summarizePhase(*single, *zero, phase);
+            if (summary.count == 0) {
+                continue;
+            }
+            double max = profile->maxNs[phase].load(memory_order_relaxed) / 1000.0;
+            fprintf(out, "%d,%s,%llu,%.3f,%.3f,%.3f,%.3f\n", profile->index, PHASE_NAMES[phase],
+                    static_cast<unsigned long long>(summary.count), summary.mean, summary.p50, summary.p99, max);
+        }
+    }
+}
+
+/**
+ * @brief Writes the kept events of every thread as complete ("X") events
+ * in the Chrome trace format, viewable in chrome://tracing or Perfetto.
+ */
+static void exportTrace(FILE* out, int threadCount) {
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (int i = 0; i < threadCount; i++) {
+        ThreadProfile* profile = profiles[i].load(memory_order_acquire);
+        if (profile == nullptr || !profile->trace) {
+            continue;
+        }
+        uint64_t end = profile->traceCount.load(memory_order_acquire);
+        uint64_t begin = end > PROFILE_TRACE_EVENTS ? end - PROFILE_TRACE_EVENTS : 0;
+        for (uint64_t n = begin; n < end; n++) {
+            const TraceEvent& event = profile->trace[n & (PROFILE_TRACE_EVENTS - 1)];
+            fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                    first ? "" : ",\n", PHASE_NAMES[event.phase], event.start / 1000.0, event.duration / 1000.0, profile->index);
+            first = false;
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+/**
+ * @brief Whether profileExport() writes a path as a Chrome trace: it ends in ".json".
+ */
+bool isTracePath(const char* path) {
+    size_t length = strlen(path);
+    return length >= 5 && strcmp(path + length - 5, ".json") == 0;
+}
+
+/**
+ * @brief Writes the profile to a file: a Chrome trace if the path ends in
+ * ".json", otherwise a CSV of per-thread phase statistics.
+ *
+ * Call it once the profiled threads are idle, e.g. at exit; events
+ * recorded while the export runs may be torn.
+ *
+ * @return false if the file could not be written.
+ */
+bool profileExport(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        return false;
+    }
+    int threadCount = profileCount.load() < PROFILE_MAX_THREADS ? profileCount.load() : PROFILE_MAX_THREADS;
+    if (isTracePath(path)) {
+        exportTrace(out, threadCount);
+    } else {
+        exportCsv(out, threadCount);
+    }
+    return fclose(out) == 0;
+}
@@ -0,0 +1,84 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+
+// Timed parts of a frame
+enum ProfilePhase {
+    PHASE_FRAME,      // a whole frame, excluding the wait for the next one
+    PHASE_EVENTS,     // polling SDL events
+    PHASE_STEP,       // one simulation tick
+    PHASE_GRAVITY,    // gravity drops, including handleCollision and locking
+    PHASE_LINE_CLEAR, // getFullRows and clearFullRows
+    PHASE_DISPLAY,    // drawing a frame, up to the present
+    PHASE_TEXT,       // drawing HUD text
+    PHASE_PRESENT,    // SDL_RenderPresent
+    PHASE_BOT,        // choosing a bot placement
+    PHASE_ROLLBACK,   // restoring a snapshot and simulating back to the present
+    PHASE_COUNT
+};
+
+extern const char* const PHASE_NAMES[PHASE_COUNT];
+
+// Histogram buckets: 8 linear sub-buckets per power of two of nanoseconds,
+// so a percentile is exact to within 12.5%
+const int PROFILE_SUB_BUCKETS = 8;
+const int PROFILE_BUCKETS = PROFILE_SUB_BUCKETS * 40;
+const int PROFILE_MAX_THREADS = 64;
+const int PROFILE_TRACE_EVENTS = 1 << 16; // most recent events kept per thread for trace export
+
+/**
+ * @brief Durations of every phase, summed over all threads.
+ */
+struct ProfileSnapshot {
+    uint64_t buckets[PHASE_COUNT][PROFILE_BUCKETS];
+    uint64_t totalNs[PHASE_COUNT];
+};
+
+/**
+ * @brief Distribution of one phase's durations, in microseconds.
+ */
+struct PhaseSummary {
+    uint64_t count = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+void profileEnable(bool enabled, bool keepTrace = false);
+bool profileEnabled();
+bool isTracePath(const char* path);
+uint64_t profileNow();
+void profileRecord(ProfilePhase phase, uint64_t start, uint64_t end);
+void profileSnapshot(ProfileSnapshot& snapshot);
+PhaseSummary summarizePhase(const ProfileSnapshot& now, const ProfileSnapshot& before, int phase);
+bool profileExport(const char* path);
+
+/**
+ * @brief Times the enclosing scope as one phase. Costs a single flag test
+ * while profiling is disabled.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), active(profileEnabled()) {
+        if (active) {
+            start = profileNow();
+        }
+    }
+    ~ProfileScope() {
+        if (active) {
+            profileRecord(phase, start, profileNow());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePhase phase;
+    bool active;
+    uint64_t start = 0;
+};
+
+#endif // PROFILER_H
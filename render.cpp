@@ -0,0 +1,427 @@
+#include "tetris.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+
+SDL_Renderer* renderer = NULL;
+
+RGB getBlockColor(int color) {
+    switch (color) {
+    case 1: return { 0, 255, 255 };    // Cyan
+    case 2: return { 0, 0, 255 };      // Blue
+    case 3: return { 255, 165, 0 };    // Orange
+    case 4: return { 255, 255, 0 };    // Yellow
+    case 5: return { 0, 255, 0 };      // Green
+    case 6: return { 128, 0, 128 };    // Purple
+    case 7: return { 255, 0, 0 };      // Red
+    case GARBAGE_COLOR: return { 128, 128, 128 }; // Gray
+    default: return { 255, 255, 255 }; // White
+    }
+}
+
+
+
+/**
+ * @brief Renders text on the screen.
+ * 
+ * @param message The text message to render.
+ * @param x The x-coordinate of the text.
+ * @param y The y-coordinate of the text.
+ * @param color The color of the text.
+ * @param text The text renderer, which caches a texture per distinct message.
+ */
+void renderText(const std::string &message, int x, int y, SDL_Color color, TextRenderer &text) {
+    text.drawCached(message, x, y, color);
+}
+
+/**
+ * @brief Converts a board color index to the SDL color of its blocks.
+ * 
+ * @param color The color index.
+ * @return SDL_Color The opaque block color.
+ */
+SDL_Color blockColor(int color) {
+    RGB rgb = getBlockColor(color);
+    return { Uint8(rgb.r), Uint8(rgb.g), Uint8(rgb.b), 255 };
+}
+
+/**
+ * @brief Draws the side borders, the next piece box and the score panel background.
+ * 
+ * @param stats Receives the draw calls made.
+ */
+void drawChrome(RenderStats& stats) {
+    // Draw vertical lines on either side of the board
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White color
+    SDL_Rect lines[2] = {
+        { BOARD_OFFSET_X - 3, 0, 3, SCREEN_HEIGHT },
+        { BOARD_OFFSET_X + BOARD_RENDER_WIDTH, 0, 3, SCREEN_HEIGHT }
+    };
+    SDL_RenderFillRects(renderer, lines, 2);
+    stats.drawCalls++;
+
+    // Outline the next piece box
+    SDL_Rect nextPieceBox = { NEXT_PIECE_BOX_X, NEXT_PIECE_BOX_Y, NEXT_PIECE_BOX_SIZE, NEXT_PIECE_BOX_SIZE };
+    SDL_RenderDrawRect(renderer, &nextPieceBox);
+    stats.drawCalls++;
+
+    // Render the score, lines, level, and next piece in the panel right of the board
+    int panelX = BOARD_OFFSET_X + BOARD_RENDER_WIDTH;
+    SDL_Rect scoreRect = { panelX + 10, 10, SCREEN_WIDTH - panelX - 20, 50 };
+    SDL_RenderFillRect(renderer, &scoreRect);
+    stats.drawCalls++;
+}
+
+/**
+ * @brief Draws the locked cells of the board.
+ * 
+ * @param board The game board.
+ * @param blocks The block batch.
+ * @param stats Receives the draw calls made.
+ */
+void drawBoard(const Board& board, BlockBatch& blocks, RenderStats& stats) {
+    // Visit only the filled cells of each row
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (RowBits bits = board.rows[y]; bits != 0; bits &= bits - 1) {
+            int x = lowestBit(bits);
+            blocks.addBlock(BOARD_OFFSET_X + x * BLOCK_SIZE, BOARD_OFFSET_Y + y * BLOCK_SIZE, BLOCK_SIZE, blockColor(board.colors[y][x]));
+        }
+    }
+    blocks.flush(stats);
+}
+
+/**
+ * @brief Draws the score, the level, the next Tetromino and the game over message.
+ * 
+ * @param state The game state.
+ * @param text The text renderer.
+ * @param blocks The block batch.
+ * @param stats Receives the draw calls made.
+ */
+void drawHud(const GameState& state, TextRenderer& text, BlockBatch& blocks, RenderStats& stats) {
+    // Display the next tetromino in the box
+    const Tetromino& nextTetromino = state.next;
+    const PieceShape& nextShape = pieceShape(nextTetromino);
+    int nextPieceOffsetX = NEXT_PIECE_BOX_X + (NEXT_PIECE_BOX_SIZE - nextShape.width * BLOCK_SIZE) / 2 - nextShape.minX * BLOCK_SIZE;
+    int nextPieceOffsetY = NEXT_PIECE_BOX_Y + (NEXT_PIECE_BOX_SIZE - nextShape.height * BLOCK_SIZE) / 2 - nextShape.minY * BLOCK_SIZE;
+    SDL_Color nextColor = blockColor(pieceColor(nextTetromino.type));
+    for (const PieceCell& cell : nextShape.cells) {
+        blocks.addBlock(nextPieceOffsetX + cell.x * BLOCK_SIZE, nextPieceOffsetY + cell.y * BLOCK_SIZE, BLOCK_SIZE, nextColor);
+    }
+    blocks.flush(stats);
+
+    ProfileScope profile(PHASE_TEXT);
+    SDL_Color textColor = { 0, 0, 0, 255 }; // Black color for text
+    // The values change as the game goes on, so draw them from the glyph atlas
+    stats.vertices += text.drawString("Rows: " + std::to_string(state.score), BOARD_OFFSET_X + BOARD_RENDER_WIDTH + 20, 20, textColor);
+    stats.vertices += text.drawString("Level: " + std::to_string(state.level), BOARD_OFFSET_X + BOARD_RENDER_WIDTH + 20, 35, textColor);
+    stats.drawCalls += 2;
+
+    if (state.gameOver) {
+        SDL_Color gameOverColor = { 255, 0, 0, 255 }; // Red color
+        renderText("Game Over", SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2, gameOverColor, text);
+        stats.drawCalls++;
+    }
+}
+
+/**
+ * @brief Returns the screen y-coordinate of the falling piece between two ticks.
+ * 
+ * The piece is drawn part of the way from where it was on the previous
+ * tick to where it is now, so gravity looks smooth at any frame rate.
+ * A new piece, a rotation or a jump of more than a row snaps instead.
+ * 
+ * @param state The game state after the latest tick.
+ * @param previous The game state one tick earlier.
+ * @param alpha How far the frame is between the two ticks, from 0 to 1.
+ * @return int The y-coordinate of the piece's box.
+ */
+int fallingPieceY(const GameState& state, const GameState& previous, double alpha) {
+    const Tetromino& current = state.current;
+    const Tetromino& before = previous.current;
+    int y = BOARD_OFFSET_Y + current.y * BLOCK_SIZE;
+    if (previous.pieceCount != state.pieceCount || before.rotation != current.rotation || current.y - before.y != 1) {
+        return y;
+    }
+    return y - int(lround((1.0 - alpha) * BLOCK_SIZE));
+}
+
+/**
+ * @brief Draws the game board, the current Tetromino, the next Tetromino and the score.
+ * 
+ * The board, the chrome and the HUD are kept in layer textures that are
+ * only redrawn when what they show changes, so a typical frame is a
+ * clear, three copies and the falling piece. If render targets are not
+ * available everything is drawn directly each frame.
+ * 
+ * @param state The game state to draw.
+ * @param previous The game state one tick earlier, for interpolating the falling piece.
+ * @param alpha How far the frame is between the two ticks, from 0 to 1.
+ * @param text The text renderer.
+ * @param blocks The block batch.
+ * @param layers The cached layers.
+ * @param clearAnimation The flash of rows waiting to be cleared.
+ * @param stats Receives the draw calls and vertices submitted.
+ */
+void drawFrame(const GameState& state, const GameState& previous, double alpha, TextRenderer &text, BlockBatch &blocks, RenderLayers &layers, const LineClearAnimation &clearAnimation, RenderStats &stats) {
+    // Bring the layers up to date
+    if (layers.beginChrome()) {
+        drawChrome(stats);
+        layers.end();
+    }
+    if (layers.beginBoard(state.board)) {
+        drawBoard(state.board, blocks, stats);
+        layers.end();
+    }
+    if (layers.beginHud(state)) {
+        drawHud(state, text, blocks, stats);
+        layers.end();
+    }
+
+    // Clear the renderer
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    stats.drawCalls++;
+
+    if (layers.isValid()) {
+        layers.composite(stats);
+    } else {
+        drawBoard(state.board, blocks, stats);
+        drawChrome(stats);
+        drawHud(state, text, blocks, stats);
+    }
+
+    drawLineClear(clearAnimation, blocks, stats);
+
+    // Display the tetromino; while rows are being cleared it is already part of the board
+    const Tetromino& tetromino = state.current;
+    if (tetromino.type != PIECE_NONE && state.pendingClear == 0) {
+        SDL_Color color = blockColor(pieceColor(tetromino.type));
+
+        // Ghost piece: a faint copy where a hard drop would land it
+        int ghostY = tetromino.y + dropDistance(tetromino, state.board);
+        if (ghostY != tetromino.y) {
+            SDL_Color ghostColor = { color.r, color.g, color.b, GHOST_ALPHA };
+            for (const PieceCell& cell : pieceShape(tetromino).cells) {
+                int x = tetromino.x + cell.x;
+                blocks.addBlock(BOARD_OFFSET_X + x * BLOCK_SIZE, BOARD_OFFSET_Y + (ghostY + cell.y) * BLOCK_SIZE, BLOCK_SIZE, ghostColor);
+            }
+        }
+
+        int pieceY = fallingPieceY(state, previous, alpha);
+        for (const PieceCell& cell : pieceShape(tetromino).cells) {
+            int x = tetromino.x + cell.x;
+            blocks.addBlock(BOARD_OFFSET_X + x * BLOCK_SIZE, pieceY + cell.y * BLOCK_SIZE, BLOCK_SIZE, color);
+        }
+        blocks.flush(stats);
+    }
+}
+
+/**
+ * @brief Chooses the grid for the many-boards view with the largest
+ * blocks that fit every board in the window, up to BLOCK_SIZE.
+ *
+ * @param boards The number of boards.
+ * @param width The window width.
+ * @param height The window height.
+ */
+WallLayout wallLayout(int boards, int width, int height) {
+    // Compared unrounded, so a wall too big for whole pixels still gets the squarest grid
+    WallLayout layout;
+    double bestSize = 0;
+    for (int columns = 1; columns <= boards; columns++) {
+        int rows = (boards + columns - 1) / columns;
+        double blockSize = std::min(double(width) / (columns * (BOARD_WIDTH + 1)), double(height) / (rows * (VISIBLE_ROWS + 1)));
+        if (blockSize > bestSize) {
+            bestSize = blockSize;
+            layout.columns = columns;
+        }
+    }
+    layout.blockSize = std::max(1, std::min(BLOCK_SIZE, int(bestSize)));
+    int rows = (boards + layout.columns - 1) / layout.columns;
+    layout.pitchX = (BOARD_WIDTH + 1) * layout.blockSize;
+    layout.pitchY = (VISIBLE_ROWS + 1) * layout.blockSize;
+    layout.originX = (width - layout.columns * layout.pitchX + layout.blockSize) / 2;
+    layout.originY = (height - rows * layout.pitchY + layout.blockSize) / 2;
+    return layout;
+}
+
+/**
+ * @brief Draws a grid of boards, each with its falling piece, in one
+ * pass: one call fills the board backgrounds and one draws every block.
+ *
+ * @param games The games, such as an arena's or a versus match's.
+ * @param count The number of games.
+ * @param layout Where the boards go, from wallLayout().
+ * @param blocks A block batch with tiles of layout.blockSize.
+ * @param stats Receives the draw calls and vertices submitted.
+ */
+void drawWall(const GameState* games, int count, const WallLayout& layout, BlockBatch& blocks, RenderStats& stats) {
+    // Keeps its capacity between frames
+    static std::vector<SDL_Rect> backgrounds;
+    backgrounds.clear();
+    int size = layout.blockSize;
+
+    for (int i = 0; i < count; i++) {
+        const GameState& state = games[i];
+        int left = layout.originX + (i % layout.columns) * layout.pitchX;
+        int top = layout.originY + (i / layout.columns) * layout.pitchY - HIDDEN_ROWS * size;
+        backgrounds.push_back({ left, top + HIDDEN_ROWS * size, BOARD_WIDTH * size, VISIBLE_ROWS * size });
+
+        for (int y = HIDDEN_ROWS; y < BOARD_HEIGHT; y++) {
+            for (uint64_t bits = state.board.rows[y]; bits != 0; bits &= bits - 1) {
+                int x = lowestBit(bits);
+                blocks.addBlock(left + x * size, top + y * size, size, blockColor(state.board.colors[y][x]));
+            }
+        }
+        const Tetromino& tetromino = state.current;
+        if (tetromino.type != PIECE_NONE && state.pendingClear == 0) {
+            SDL_Color color = blockColor(pieceColor(tetromino.type));
+            for (const PieceCell& cell : pieceShape(tetromino).cells) {
+                if (tetromino.y + cell.y >= HIDDEN_ROWS) {
+                    blocks.addBlock(left + (tetromino.x + cell.x) * size, top + (tetromino.y + cell.y) * size, size, color);
+                }
+            }
+        }
+    }
+
+    SDL_SetRenderDrawColor(renderer, 32, 32, 32, 255);
+    SDL_RenderFillRects(renderer, backgrounds.data(), int(backgrounds.size()));
+    stats.drawCalls++;
+    blocks.flush(stats);
+}
+
+/**
+ * @brief Draws the profiler's phase timings in the bottom left corner.
+ * 
+ * @param overlay The overlay text.
+ * @param text The text renderer.
+ * @param stats Receives the draw calls made.
+ */
+void drawProfileOverlay(const ProfileOverlay& overlay, TextRenderer& text, RenderStats& stats) {
+    ProfileScope profile(PHASE_TEXT);
+    int lineHeight = text.lineHeight();
+    int y = SCREEN_HEIGHT - int(overlay.lines.size()) * lineHeight - 10;
+    SDL_Rect background = { 5, y - 5, BOARD_OFFSET_X - 10, int(overlay.lines.size()) * lineHeight + 10 };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+    SDL_RenderFillRect(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    stats.drawCalls++;
+
+    SDL_Color color = { 255, 255, 255, 255 };
+    for (const std::string& line : overlay.lines) {
+        stats.vertices += text.drawString(line, 10, y, color);
+        stats.drawCalls++;
+        y += lineHeight;
+    }
+}
+
+/**
+ * @brief Displays a frame: draws it, adds the profiler overlay if shown, and presents it.
+ * 
+ * @param state The game state to draw.
+ * @param previous The game state one tick earlier, for interpolating the falling piece.
+ * @param alpha How far the frame is between the two ticks, from 0 to 1.
+ * @param text The text renderer.
+ * @param blocks The block batch.
+ * @param layers The cached layers.
+ * @param clearAnimation The flash of rows waiting to be cleared.
+ * @param overlay The profiler overlay.
+ * @return RenderStats The draw calls and vertices submitted for the frame.
+ */
+RenderStats display(const GameState& state, const GameState& previous, double alpha, TextRenderer &text, BlockBatch &blocks, RenderLayers &layers, const LineClearAnimation &clearAnimation, const ProfileOverlay &overlay) {
+    RenderStats stats;
+    {
+        ProfileScope profile(PHASE_DISPLAY);
+        drawFrame(state, previous, alpha, text, blocks, layers, clearAnimation, stats);
+        if (overlay.visible) {
+            drawProfileOverlay(overlay, text, stats);
+        }
+    }
+
+    ProfileScope profile(PHASE_PRESENT);
+    SDL_RenderPresent(renderer);
+    return stats;
+}
+
+/**
+ * @brief Rebuilds the overlay text from the phase timings recorded since
+ * the previous update.
+ */
+void ProfileOverlay::update() {
+    std::swap(current, previous);
+    profileSnapshot(*current);
+    lines.clear();
+    lines.push_back("phase  p50 / p99 / max us");
+    char line[64];
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        PhaseSummary summary = summarizePhase(*current, *previous, phase);
+        if (summary.count == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%s  %.0f / %.0f / %.0f", PHASE_NAMES[phase], summary.p50, summary.p99, summary.max);
+        lines.push_back(line);
+    }
+}
+
+/**
+ * @brief Follows the game's pending rows and advances the flash timer.
+ * 
+ * @param pendingRows The rows the game is about to clear.
+ * @param frameTime The milliseconds since the previous frame.
+ */
+void LineClearAnimation::update(RowMask pendingRows, Uint32 frameTime) {
+    if (pendingRows != rows) {
+        rows = pendingRows;
+        elapsed = 0;
+    } else if (rows != 0) {
+        elapsed += frameTime;
+    }
+}
+
+/**
+ * @brief Whether the flashing rows are lit in the current phase. They start hidden.
+ */
+bool LineClearAnimation::rowsVisible() const {
+    return (elapsed / FLASH_INTERVAL) % 2 == 1;
+}
+
+/**
+ * @brief Draws the flashing rows over the board layer.
+ * 
+ * Hidden rows are covered with the background color and lit rows are
+ * drawn as solid blocks, so the board itself is never modified.
+ * 
+ * @param animation The line clear animation.
+ * @param blocks The block batch.
+ * @param stats Receives the draw calls made.
+ */
+void drawLineClear(const LineClearAnimation& animation, BlockBatch& blocks, RenderStats& stats) {
+    if (animation.rows == 0) {
+        return;
+    }
+
+    if (animation.rowsVisible()) {
+        SDL_Color color = blockColor(1);
+        for (RowMask rows = animation.rows; rows != 0; rows &= rows - 1) {
+            int y = lowestBit(rows);
+            for (int x = 0; x < BOARD_WIDTH; x++) {
+                blocks.addBlock(BOARD_OFFSET_X + x * BLOCK_SIZE, BOARD_OFFSET_Y + y * BLOCK_SIZE, BLOCK_SIZE, color);
+            }
+        }
+        blocks.flush(stats);
+    } else {
+        SDL_Rect covers[BOARD_HEIGHT];
+        int count = 0;
+        for (RowMask rows = animation.rows; rows != 0; rows &= rows - 1) {
+            int y = lowestBit(rows);
+            covers[count++] = { BOARD_OFFSET_X, BOARD_OFFSET_Y + y * BLOCK_SIZE, BOARD_RENDER_WIDTH, BLOCK_SIZE };
+        }
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderFillRects(renderer, covers, count);
+        stats.drawCalls++;
+    }
+}
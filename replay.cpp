@@ -0,0 +1,457 @@
+#include "replay.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const char REPLAY_MAGIC[4] = { 'T', 'R', 'P', 'L' };
+const uint8_t REPLAY_VERSION = 2;
+
+
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+/**
+ * @brief Starts recording a session and writes the replay header.
+ *
+ * @param path The replay file to create.
+ * @param state The game, freshly reset and configured.
+ * @param seed The seed it was reset with.
+ * @return true if the file was created.
+ */
+bool ReplayWriter::open(const char* path, const GameState& state, uint64_t seed) {
+    close();
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    buffer.reserve(REPLAY_BUFFER_SIZE + sizeof(GameState) + 16);
+    written = 0;
+    recordTick = state.tick;
+    stateTick = state.tick;
+    lastInput = INPUT_NONE;
+    lastPieceCount = state.pieceCount;
+
+    for (char c : REPLAY_MAGIC) {
+        putByte(uint8_t(c));
+    }
+    putByte(REPLAY_VERSION);
+    putByte(uint8_t(BOARD_WIDTH));
+    putByte(uint8_t(BOARD_HEIGHT));
+    putVarint(sizeof(GameState));
+    for (int i = 0; i < 8; i++) {
+        putByte(uint8_t(seed >> (8 * i)));
+    }
+    putByte(uint8_t(state.rules.randomizer));
+    putByte(uint8_t(state.rules.scoring));
+    putByte(uint8_t(state.rules.leveling));
+    putVarint(uint64_t(state.dasTicks));
+    putVarint(uint64_t(state.arrTicks));
+    return true;
+}
+
+/**
+ * @brief Records one tick. Call after every GameState::step with the
+ * input passed to it; ticks where the game did not advance are ignored.
+ *
+ * @param state The game after the step.
+ * @param input The buttons held during the step.
+ */
+void ReplayWriter::record(const GameState& state, Input input) {
+    if (file == NULL || state.tick == stateTick) {
+        return;
+    }
+    stateTick = state.tick;
+    if (input != lastInput) {
+        putRecord(state.tick, REPLAY_INPUT);
+        putByte(input);
+        lastInput = input;
+    }
+    if (state.pieceCount != lastPieceCount) {
+        putRecord(state.tick, REPLAY_SPAWN);
+        putByte(uint8_t(state.next.type));
+        lastPieceCount = state.pieceCount;
+    }
+    if (state.tick % KEYFRAME_TICKS == 0) {
+        putRecord(state.tick, REPLAY_KEYFRAME);
+        putVarint(sizeof(GameState));
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(GameState));
+        flush();
+    } else if (buffer.size() >= size_t(REPLAY_BUFFER_SIZE)) {
+        flush();
+    }
+}
+
+/**
+ * @brief Marks the end of the session and closes the file.
+ */
+void ReplayWriter::close() {
+    if (file == NULL) {
+        return;
+    }
+    putRecord(stateTick, REPLAY_END);
+    flush();
+    fclose(file);
+    file = NULL;
+}
+
+void ReplayWriter::putByte(uint8_t value) {
+    buffer.push_back(value);
+}
+
+void ReplayWriter::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(uint8_t(value));
+}
+
+void ReplayWriter::putRecord(uint64_t tick, ReplayRecordType type) {
+    putVarint((tick - recordTick) << 2 | uint64_t(type));
+    recordTick = tick;
+}
+
+void ReplayWriter::flush() {
+    if (!buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        fflush(file);
+        written += buffer.size();
+        buffer.clear();
+    }
+}
+
+
+static bool validPiece(const Tetromino& tetromino) {
+    return tetromino.type >= 0 && tetromino.type < PIECE_COUNT && tetromino.rotation >= 0 && tetromino.rotation < ROTATION_COUNT
+        && tetromino.x >= -PIECE_BOX_SIZE && tetromino.x <= BOARD_WIDTH && tetromino.y >= -PIECE_BOX_SIZE && tetromino.y <= BOARD_HEIGHT;
+}
+
+/**
+ * @brief Checks a keyframe read from a file before it is restored, so a
+ * corrupt or edited replay cannot make step() index the piece tables or
+ * the board out of bounds.
+ *
+ * Pieces, the bag and the rules must be in range, the board must have no
+ * cells outside its width and its hash and skyline must match its cells,
+ * and a game still in play must have its piece where it fits, unless
+ * it has just locked it and is waiting to clear rows.
+ */
+static bool validSnapshot(const GameState& state) {
+    if (!validPiece(state.current) || !validPiece(state.next)) {
+        return false;
+    }
+    if (state.bagIndex < 0 || state.bagIndex > PIECE_COUNT) {
+        return false;
+    }
+    for (uint8_t type : state.bag) {
+        if (type >= PIECE_COUNT) {
+            return false;
+        }
+    }
+    if (state.rules.randomizer > RANDOMIZER_BAG || state.rules.scoring > SCORING_GUIDELINE || state.rules.leveling > LEVELING_NONE
+        || state.rules.randomizer < 0 || state.rules.scoring < 0 || state.rules.leveling < 0) {
+        return false;
+    }
+    if (state.dasTicks < 0 || state.arrTicks < 1 || state.dropTicks < 1 || state.incomingGarbage < 0 || state.outgoingGarbage < 0) {
+        return false;
+    }
+    // Only rows on the board can be waiting to clear
+    if (BOARD_HEIGHT < 64 && (state.pendingClear >> (BOARD_HEIGHT % 64)) != 0) {
+        return false;
+    }
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        if ((state.board.rows[y] & RowBits(~FULL_ROW)) != 0) {
+            return false;
+        }
+    }
+    Board indexed = state.board;
+    rebuildBoardIndex(indexed);
+    if (indexed.hash != state.board.hash || memcmp(indexed.heights, state.board.heights, sizeof(indexed.heights)) != 0) {
+        return false;
+    }
+    // While rows wait to clear, the piece in play is the one locked into them
+    return state.gameOver || state.pendingClear != 0 || pieceFits(state.current, state.board);
+}
+
+ReplayReader::~ReplayReader() {
+    close();
+}
+
+/**
+ * @brief Maps a replay file and indexes it.
+ *
+ * @param path The replay file.
+ * @return true if the file could be mapped and has a valid header for
+ * a board of the size this build plays on.
+ */
+bool ReplayReader::open(const char* path) {
+    close();
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle = handle;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL) {
+        close();
+        return false;
+    }
+    data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data == NULL) {
+        close();
+        return false;
+    }
+    size = size_t(fileSize.QuadPart);
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(NULL, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const uint8_t*>(mapping);
+    size = size_t(info.st_size);
+#endif
+
+    // Header; a game on a board of another size cannot be replayed
+    size_t pos = sizeof(REPLAY_MAGIC) + 3;
+    uint64_t stateSize = 0, dasTicks = 0, arrTicks = 0;
+    if (size < pos || memcmp(data, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0 || data[pos - 3] != REPLAY_VERSION
+        || data[pos - 2] != BOARD_WIDTH || data[pos - 1] != BOARD_HEIGHT
+        || !readVarint(pos, stateSize) || pos + 11 > size) {
+        close();
+        return false;
+    }
+    settings.seed = 0;
+    for (int i = 0; i < 8; i++) {
+        settings.seed |= uint64_t(data[pos + i]) << (8 * i);
+    }
+    settings.rules.randomizer = Randomizer(data[pos + 8]);
+    settings.rules.scoring = ScoringRule(data[pos + 9]);
+    settings.rules.leveling = LevelingRule(data[pos + 10]);
+    pos += 11;
+    if (!readVarint(pos, dasTicks) || !readVarint(pos, arrTicks)) {
+        close();
+        return false;
+    }
+    settings.dasTicks = int(dasTicks);
+    settings.arrTicks = int(arrTicks);
+    recordsStart = pos;
+
+    // Snapshots are raw GameState bytes, so only a build with the same layout can restore them
+    keyframesUsable = stateSize == sizeof(GameState);
+    Record record;
+    uint64_t tick = 0;
+    while (readRecord(pos, tick, record)) {
+        if (record.type == REPLAY_KEYFRAME && keyframesUsable && record.payloadSize == sizeof(GameState)) {
+            // A keyframe that fails the checks is skipped; seeking simulates from the one before it
+            GameState snapshot;
+            memcpy(&snapshot, data + record.payload, sizeof(GameState));
+            if (validSnapshot(snapshot)) {
+                keyframes.push_back({ record.tick, record.payload, record.next });
+            } else {
+                LOG_WARN("Skipping corrupt replay keyframe at tick %llu", static_cast<unsigned long long>(record.tick));
+            }
+        }
+        tick = record.tick;
+        pos = record.next;
+    }
+    lastTick = tick;
+    cursor = recordsStart;
+    return true;
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+void ReplayReader::close() {
+#if defined(_WIN32)
+    if (data != NULL) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != NULL) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != NULL) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = NULL;
+    fileHandle = NULL;
+#else
+    if (data != NULL) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+    data = NULL;
+    size = 0;
+    keyframes.clear();
+    lastTick = 0;
+    divergence = false;
+}
+
+/**
+ * @brief Resets a game to the start of the replay.
+ *
+ * @param state Receives the game at tick 0.
+ */
+void ReplayReader::restart(GameState& state) {
+    state.rules = settings.rules;
+    state.dasTicks = settings.dasTicks;
+    state.arrTicks = settings.arrTicks;
+    state.reset(settings.seed);
+    cursor = recordsStart;
+    cursorTick = 0;
+    currentInput = INPUT_NONE;
+    divergence = false;
+}
+
+/**
+ * @brief Advances the game one tick with the recorded input.
+ *
+ * The game must have been started by restart() and advanced only by this
+ * reader. A spawn that differs from the recording sets diverged().
+ *
+ * @param state The game to advance.
+ * @return bool false once the recording has ended.
+ */
+bool ReplayReader::step(GameState& state) {
+    if (state.gameOver || state.tick >= lastTick) {
+        return false;
+    }
+    uint64_t tick = state.tick + 1;
+
+    // Inputs recorded for this tick apply to it
+    Record record;
+    while (readRecord(cursor, cursorTick, record) && (record.tick < tick || (record.tick == tick && record.type == REPLAY_INPUT))) {
+        if (record.type == REPLAY_INPUT) {
+            currentInput = data[record.payload];
+        }
+        cursor = record.next;
+        cursorTick = record.tick;
+    }
+
+    state.step(currentInput);
+
+    // The rest describe the game after it
+    while (readRecord(cursor, cursorTick, record) && record.tick == tick && record.type != REPLAY_INPUT) {
+        if (record.type == REPLAY_SPAWN && data[record.payload] != state.next.type) {
+            divergence = true;
+        }
+        cursor = record.next;
+        cursorTick = record.tick;
+    }
+    return true;
+}
+
+/**
+ * @brief Moves the game to a tick at full simulation speed, without rendering.
+ *
+ * Restores the last keyframe at or before the tick when that is ahead of
+ * the game, then simulates the remaining ticks. Seeking backwards starts
+ * over from the keyframe or the beginning.
+ *
+ * @param state The game, as for step().
+ * @param tick The tick to reach; past the end it stops at the end.
+ * @param useKeyframes false to simulate every tick from where the game is.
+ * @return uint64_t The number of ticks simulated.
+ */
+uint64_t ReplayReader::seek(GameState& state, uint64_t tick, bool useKeyframes) {
+    uint64_t target = min(tick, lastTick);
+    if (state.tick > target) {
+        restart(state);
+    }
+
+    if (useKeyframes && !keyframes.empty()) {
+        auto after = upper_bound(keyframes.begin(), keyframes.end(), target,
+                                 [](uint64_t value, const Keyframe& keyframe) { return value < keyframe.tick; });
+        if (after != keyframes.begin()) {
+            const Keyframe& keyframe = *(after - 1);
+            if (keyframe.tick > state.tick) {
+                memcpy(&state, data + keyframe.snapshot, sizeof(GameState));
+                cursor = keyframe.next;
+                cursorTick = keyframe.tick;
+                currentInput = state.heldInput;
+            }
+        }
+    }
+
+    uint64_t simulated = 0;
+    while (state.tick < target && step(state)) {
+        simulated++;
+    }
+    return simulated;
+}
+
+bool ReplayReader::readVarint(size_t& pos, uint64_t& value) const {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) {
+            return false;
+        }
+        uint8_t byte = data[pos++];
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decodes the record at an offset.
+ *
+ * @return bool false at the end of the file or at a record cut short.
+ */
+bool ReplayReader::readRecord(size_t pos, uint64_t previousTick, Record& record) const {
+    uint64_t head;
+    if (!readVarint(pos, head)) {
+        return false;
+    }
+    record.type = ReplayRecordType(head & 3);
+    record.tick = previousTick + (head >> 2);
+    record.payloadSize = 0;
+    if (record.type == REPLAY_INPUT || record.type == REPLAY_SPAWN) {
+        record.payloadSize = 1;
+    } else if (record.type == REPLAY_KEYFRAME) {
+        uint64_t length;
+        if (!readVarint(pos, length) || length > size) {
+            return false;
+        }
+        record.payloadSize = size_t(length);
+    }
+    if (pos + record.payloadSize > size) {
+        return false;
+    }
+    record.payload = pos;
+    record.next = pos + record.payloadSize;
+    return true;
+}
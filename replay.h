@@ -0,0 +1,156 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+#include "game.h"
+
+// Ticks between keyframe snapshots in a replay
+const int KEYFRAME_TICKS = 10 * TICKS_PER_SECOND;
+// Bytes a recording collects before writing them to disk
+const int REPLAY_BUFFER_SIZE = 64 * 1024;
+
+static_assert(std::is_trivially_copyable<GameState>::value, "Keyframes store GameState as raw bytes");
+
+/**
+ * Replay file layout. All multi-byte integers are little endian; "varint"
+ * is LEB128, 7 bits per byte with the high bit set on all but the last.
+ *
+ *   header:  "TRPL", version byte, board width and height bytes,
+ *            varint sizeof(GameState), 8-byte seed,
+ *            randomizer, scoring and leveling bytes, varint dasTicks,
+ *            varint arrTicks
+ *   records: varint (tick delta << 2 | type), then the payload
+ *            REPLAY_INPUT     1 byte: the buttons held from this tick on
+ *            REPLAY_SPAWN     1 byte: the type of the piece drawn as next
+ *            REPLAY_KEYFRAME  varint size, then the GameState after the tick
+ *            REPLAY_END       nothing; the last tick of the session
+ *
+ * The tick delta is relative to the previous record. Inputs are written
+ * only when they change. Spawns are not needed to replay, since the seed
+ * fixes the pieces, but let playback detect a replay that has diverged.
+ */
+enum ReplayRecordType {
+    REPLAY_INPUT,
+    REPLAY_SPAWN,
+    REPLAY_KEYFRAME,
+    REPLAY_END
+};
+
+// Settings a replay starts from
+struct ReplayHeader {
+    uint64_t seed = 0;
+    GameRules rules;
+    int dasTicks = DAS_TICKS;
+    int arrTicks = ARR_TICKS;
+};
+
+/**
+ * @brief Streams a session to a replay file.
+ *
+ * Records go to a memory buffer that is written out when it fills and
+ * after every keyframe, so a crash loses at most the last few seconds.
+ */
+class ReplayWriter {
+public:
+    ReplayWriter() = default;
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    bool open(const char* path, const GameState& state, uint64_t seed);
+    void record(const GameState& state, Input input);
+    void close();
+
+    bool isOpen() const { return file != NULL; }
+    uint64_t bytesWritten() const { return written + buffer.size(); }
+
+private:
+    void putByte(uint8_t value);
+    void putVarint(uint64_t value);
+    void putRecord(uint64_t tick, ReplayRecordType type);
+    void flush();
+
+    FILE* file = NULL;
+    std::vector<uint8_t> buffer;
+    uint64_t written = 0;
+    uint64_t recordTick = 0;  // tick of the last record
+    uint64_t stateTick = 0;   // last tick seen by record()
+    Input lastInput = INPUT_NONE;
+    int lastPieceCount = 0;
+};
+
+/**
+ * @brief Plays back a replay file, memory-mapped.
+ *
+ * Opening the file scans it once to index its keyframes and find its
+ * last tick; a file cut short by a crash plays up to its last complete
+ * record. step() advances a game one recorded tick, for real-time
+ * playback. seek() jumps to any tick by restoring the nearest keyframe
+ * at or before it and simulating only the ticks after that. Keyframes
+ * whose game fails a consistency check are left out of the index, so a
+ * corrupt one costs simulation time instead of restoring a broken game.
+ */
+class ReplayReader {
+public:
+    ReplayReader() = default;
+    ~ReplayReader();
+
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    bool open(const char* path);
+    void close();
+
+    const ReplayHeader& header() const { return settings; }
+    uint64_t endTick() const { return lastTick; }
+    size_t keyframeCount() const { return keyframes.size(); }
+    size_t fileSize() const { return size; }
+    bool diverged() const { return divergence; }
+
+    void restart(GameState& state);
+    bool step(GameState& state);
+    uint64_t seek(GameState& state, uint64_t tick, bool useKeyframes = true);
+
+private:
+    struct Record {
+        ReplayRecordType type;
+        uint64_t tick;
+        size_t payload;     // offset of the payload
+        size_t payloadSize;
+        size_t next;        // offset of the following record
+    };
+    struct Keyframe {
+        uint64_t tick;
+        size_t snapshot; // offset of the GameState bytes
+        size_t next;     // offset of the record after the keyframe
+    };
+
+    bool readVarint(size_t& pos, uint64_t& value) const;
+    bool readRecord(size_t pos, uint64_t previousTick, Record& record) const;
+
+    const uint8_t* data = NULL;
+    size_t size = 0;
+#if defined(_WIN32)
+    void* fileHandle = NULL;
+    void* mappingHandle = NULL;
+#endif
+
+    ReplayHeader settings;
+    size_t recordsStart = 0;
+    bool keyframesUsable = false;
+    std::vector<Keyframe> keyframes;
+    uint64_t lastTick = 0;
+
+    // Playback position: the next record to read and the tick of the last one read
+    size_t cursor = 0;
+    uint64_t cursorTick = 0;
+    Input currentInput = INPUT_NONE;
+    bool divergence = false;
+};
+
+#endif // REPLAY_H
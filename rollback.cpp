@@ -0,0 +1,166 @@
+#include "rollback.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <type_traits>
+
+using namespace std;
+
+// Input packet: type, first tick, ack, input count, then one byte per input.
+// Ticks are sent as 32 bits, enough for over a year of play.
+const uint8_t PACKET_INPUTS = 1;
+const int PACKET_HEADER_SIZE = 10;
+
+static_assert(PACKET_HEADER_SIZE + ROLLBACK_WINDOW <= MAX_PACKET_SIZE, "A packet holds a window of inputs");
+static_assert(sizeof(Input) == 1, "Inputs are sent as single bytes");
+
+
+static void writeTick(uint8_t* out, uint64_t tick) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = uint8_t(tick >> (8 * i));
+    }
+}
+
+static uint64_t readTick(const uint8_t* in) {
+    uint64_t tick = 0;
+    for (int i = 0; i < 4; i++) {
+        tick |= uint64_t(in[i]) << (8 * i);
+    }
+    return tick;
+}
+
+/**
+ * @brief Starts a match with the local player on one side of it.
+ *
+ * @param localPlayer 0 or 1, the player this peer's inputs drive.
+ * @param seed Seeds the match; both peers must use the same one.
+ * @param rules The rules; both peers must use the same ones.
+ * @param transport Carries packets to and from the other peer.
+ */
+RollbackSession::RollbackSession(int localPlayer, uint64_t seed, const GameRules& rules, Transport& transport)
+    : local(localPlayer), transport(transport), rollbackFrom(UINT64_MAX) {
+    live.reset(seed, rules);
+}
+
+/**
+ * @brief Reads every waiting packet and rolls back if any remote input
+ * it brings was mispredicted.
+ */
+void RollbackSession::poll() {
+    uint8_t buffer[MAX_PACKET_SIZE];
+    for (int size = transport.receive(buffer, MAX_PACKET_SIZE); size > 0; size = transport.receive(buffer, MAX_PACKET_SIZE)) {
+        receivePacket(buffer, size);
+    }
+    if (rollbackFrom < current) {
+        rollBack(rollbackFrom);
+    }
+    rollbackFrom = UINT64_MAX;
+}
+
+/**
+ * @brief Simulates the next tick with the local input and the remote
+ * input, known or predicted.
+ *
+ * @param localInput The local player's buttons for this tick.
+ * @return false if the session is too far ahead of the other peer to
+ * keep a snapshot it could need, and waited instead.
+ */
+bool RollbackSession::advance(Input localInput) {
+    if (current - confirmedTick() >= uint64_t(ROLLBACK_WINDOW) || current - localAcked >= uint64_t(ROLLBACK_WINDOW)) {
+        counters.stalls++;
+        sendInputs();
+        return false;
+    }
+    localInputs[current % ROLLBACK_INPUT_RING] = localInput;
+    simulate(current);
+    current++;
+    counters.ticks++;
+    sendInputs();
+    return true;
+}
+
+/**
+ * @brief The remote input assumed for a tick not heard about yet: the
+ * last one known, since buttons are mostly held or released for many ticks.
+ */
+Input RollbackSession::predictRemote() const {
+    return remoteEnd > 0 ? remoteInputs[(remoteEnd - 1) % ROLLBACK_INPUT_RING] : Input(INPUT_NONE);
+}
+
+void RollbackSession::receivePacket(const uint8_t* data, int size) {
+    if (size < PACKET_HEADER_SIZE || data[0] != PACKET_INPUTS || size < PACKET_HEADER_SIZE + data[9]) {
+        return;
+    }
+    counters.packetsReceived++;
+    uint64_t first = readTick(data + 1);
+    uint64_t end = first + data[9];
+    localAcked = max(localAcked, min(readTick(data + 5), current));
+
+    // Packets start at the last acknowledged input, so one that starts
+    // past remoteEnd only arrives ahead of a lost or late packet
+    if (first > remoteEnd) {
+        return;
+    }
+    for (uint64_t t = remoteEnd; t < end; t++) {
+        Input input = data[PACKET_HEADER_SIZE + (t - first)];
+        remoteInputs[t % ROLLBACK_INPUT_RING] = input;
+        if (t < current && input != predicted[t % ROLLBACK_INPUT_RING]) {
+            rollbackFrom = min(rollbackFrom, t);
+        }
+    }
+    remoteEnd = max(remoteEnd, end);
+}
+
+/**
+ * @brief Sends every local input the other peer has not acknowledged,
+ * and acknowledges the remote inputs received.
+ */
+void RollbackSession::sendInputs() {
+    uint8_t packet[MAX_PACKET_SIZE];
+    int count = int(current - localAcked);
+    packet[0] = PACKET_INPUTS;
+    writeTick(packet + 1, localAcked);
+    writeTick(packet + 5, remoteEnd);
+    packet[9] = uint8_t(count);
+    for (int i = 0; i < count; i++) {
+        packet[PACKET_HEADER_SIZE + i] = localInputs[(localAcked + i) % ROLLBACK_INPUT_RING];
+    }
+    transport.send(packet, PACKET_HEADER_SIZE + count);
+    counters.packetsSent++;
+}
+
+/**
+ * @brief Restores the snapshot taken before a tick and simulates again
+ * from there to the present with the inputs known now.
+ */
+void RollbackSession::rollBack(uint64_t from) {
+    uint64_t start = profileNow();
+    live = snapshots[from % ROLLBACK_WINDOW];
+    for (uint64_t t = from; t < current; t++) {
+        simulate(t);
+    }
+    uint64_t end = profileNow();
+    if (profileEnabled()) {
+        profileRecord(PHASE_ROLLBACK, start, end);
+    }
+
+    int ticks = int(current - from);
+    counters.rollbacks++;
+    counters.resimulatedTicks += ticks;
+    counters.resimulateNs += end - start;
+    counters.worstResimulateNs = max(counters.worstResimulateNs, end - start);
+    counters.worstRollbackTicks = max(counters.worstRollbackTicks, ticks);
+}
+
+/**
+ * @brief Snapshots the match and simulates one tick of it.
+ */
+void RollbackSession::simulate(uint64_t tick) {
+    snapshots[tick % ROLLBACK_WINDOW] = live;
+    Input remote = tick < remoteEnd ? remoteInputs[tick % ROLLBACK_INPUT_RING] : predictRemote();
+    predicted[tick % ROLLBACK_INPUT_RING] = remote;
+    Input inputs[VERSUS_PLAYERS];
+    inputs[local] = localInputs[tick % ROLLBACK_INPUT_RING];
+    inputs[1 - local] = remote;
+    live.step(inputs[0], inputs[1]);
+}
@@ -0,0 +1,85 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <cstdint>
+#include "transport.h"
+#include "versus.h"
+
+// Ticks of snapshots kept: the furthest a peer runs ahead of the last
+// tick it has the other player's input for, and the longest rollback
+const int ROLLBACK_WINDOW = 64;
+// Ticks of inputs kept per player
+const int ROLLBACK_INPUT_RING = 2 * ROLLBACK_WINDOW;
+
+/**
+ * @brief Counters of a rollback session.
+ */
+struct RollbackStats {
+    uint64_t ticks = 0;            // ticks advanced
+    uint64_t stalls = 0;           // calls to advance() that waited for the other peer
+    uint64_t rollbacks = 0;        // mispredicted remote inputs corrected
+    uint64_t resimulatedTicks = 0; // ticks simulated again by rollbacks
+    uint64_t resimulateNs = 0;     // time spent restoring and resimulating
+    uint64_t worstResimulateNs = 0;
+    int worstRollbackTicks = 0;
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+};
+
+/**
+ * @brief One peer of a versus match played over an unreliable transport
+ * with rollback.
+ *
+ * Each tick the peer simulates at once with its own input and a
+ * prediction of the remote one, the remote player's last known input.
+ * When the real input arrives and differs from the prediction, the peer
+ * restores the snapshot taken before the mispredicted tick and simulates
+ * forward again to the present.
+ *
+ * Snapshots and inputs live in fixed rings inside the session, and a
+ * snapshot is a plain copy of the VersusState, so neither saving nor
+ * restoring allocates. Every packet carries all the local inputs the
+ * peer has not acknowledged yet, so lost packets need no resend; a peer
+ * that gets ROLLBACK_WINDOW ticks ahead of what it has heard stalls.
+ */
+class RollbackSession {
+public:
+    RollbackSession(int localPlayer, uint64_t seed, const GameRules& rules, Transport& transport);
+
+    RollbackSession(const RollbackSession&) = delete;
+    RollbackSession& operator=(const RollbackSession&) = delete;
+
+    void poll();
+    bool advance(Input localInput);
+    void sendInputs();
+
+    const VersusState& state() const { return live; }
+    int localPlayer() const { return local; }
+    uint64_t tick() const { return current; }
+    // Ticks for which both players' inputs are known; the state is final up to here
+    uint64_t confirmedTick() const { return remoteEnd < current ? remoteEnd : current; }
+    uint64_t remoteInputEnd() const { return remoteEnd; }
+    const RollbackStats& stats() const { return counters; }
+
+private:
+    Input predictRemote() const;
+    void receivePacket(const uint8_t* data, int size);
+    void rollBack(uint64_t from);
+    void simulate(uint64_t tick);
+
+    int local;
+    Transport& transport;
+    VersusState live;
+    uint64_t current = 0;   // ticks simulated
+    uint64_t remoteEnd = 0; // remote inputs are known for every tick before this
+    uint64_t localAcked = 0; // the peer has every local input before this
+    uint64_t rollbackFrom;   // earliest mispredicted tick found since the last rollback
+    RollbackStats counters;
+
+    VersusState snapshots[ROLLBACK_WINDOW]; // state before tick t, at t % ROLLBACK_WINDOW
+    Input localInputs[ROLLBACK_INPUT_RING];
+    Input remoteInputs[ROLLBACK_INPUT_RING];
+    Input predicted[ROLLBACK_INPUT_RING]; // remote input each simulated tick used
+};
+
+#endif // ROLLBACK_H
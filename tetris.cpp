@@ -1,72 +1,39 @@
 #include "tetris.h"
+#include "log.h"
 
 #include <iostream>
 #include <conio.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
 #include <string>
 
 
 SDL_Window* window = NULL;
-SDL_Renderer* renderer = NULL;
-
-const int boardWidth = 10;
-const int boardHeight = 24;
-
-bool rotateKeyPressed = false;
-bool rightKeyPressed = false;
-bool leftKeyPressed = false;
-bool downKeyPressed = false;
-int clearedRowsCount = 0;
-int score = 0;
-int level = 1;
-int linesCleared = 0;
-int dropInterval = DROP_INTERVAL;
-vector<vector<int>> board(boardHeight, vector<int>(boardWidth, 0));
-
-
-RGB getBlockColor(int color) {
-    switch (color) {
-    case 1: return { 0, 255, 255 };    // Cyan
-    case 2: return { 0, 0, 255 };      // Blue
-    case 3: return { 255, 165, 0 };    // Orange
-    case 4: return { 255, 255, 0 };    // Yellow
-    case 5: return { 0, 255, 0 };      // Green
-    case 6: return { 128, 0, 128 };    // Purple
-    case 7: return { 255, 0, 0 };      // Red
-    default: return { 255, 255, 255 }; // White
-    }
-}
-
-
-vector<Tetromino> tetrominos = {
-    {{{ 1, 1, 1, 1 }}, 3, 0, 1},              // I
-    {{{ 1, 1, 1 }, { 1, 0, 0 }}, 3, 0, 2},    // J
-    {{{ 1, 1, 1 }, { 0, 0, 1 }}, 3, 0, 3},    // L
-    {{{ 1, 1 }, { 1, 1 }}, 4, 0, 4},          // O
-    {{{ 0, 1, 1 }, { 1, 1, 0 }}, 3, 0, 5},    // S
-    {{{ 1, 1, 1 }, { 0, 1, 0 }}, 3, 0, 6},    // T
-    {{{ 1, 1, 0 }, { 0, 1, 1 }}, 3, 0, 7}     // Z
-};
+// Performance counter value when main() started, for --measure-startup
+Uint64 launchTime = 0;
 
 
 // Initialize SDL_ttf
-bool init() {
+bool init(bool vsync, int width, int height) {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << endl;
         return false;
     }
 
-    if (TTF_Init() == -1) {
-        cout << "SDL_ttf could not initialize! TTF_Error: " << TTF_GetError() << endl;
-        return false;
-    }
-
-    window = SDL_CreateWindow("Tetris", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    window = SDL_CreateWindow("Tetris", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_SHOWN);
     if (window == NULL) {
         cout << "Window could not be created! SDL_Error: " << SDL_GetError() << endl;
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+    if (vsync) {
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    renderer = SDL_CreateRenderer(window, -1, flags);
     if (renderer == NULL) {
         cout << "Renderer could not be created! SDL_Error: " << SDL_GetError() << endl;
         return false;
@@ -76,10 +43,6 @@ bool init() {
 }
 
 
-bool isGameOver(const Tetromino& tetromino, const vector<vector<int>>& board) {
-    return checkCollision(tetromino, board);
-}
-
 // Cleanup SDL_ttf
 void close() {
     SDL_DestroyRenderer(renderer);
@@ -87,451 +50,697 @@ void close() {
     window = NULL;
     renderer = NULL;
 
-    TTF_Quit();
+    // SDL_ttf is only started when a font file is loaded
+    if (TTF_WasInit()) {
+        TTF_Quit();
+    }
     SDL_Quit();
 }
 
 /**
- * @brief Renders text on the screen.
+ * @brief Waits for a performance counter deadline, collecting input on the way.
  * 
- * @param message The text message to render.
- * @param x The x-coordinate of the text.
- * @param y The y-coordinate of the text.
- * @param color The color of the text.
- * @param font The TTF font.
- * @param renderer The SDL renderer.
+ * The wait sleeps in one millisecond slices, pumping events after each so
+ * key presses are timestamped close to when they happened. SDL_Delay may
+ * oversleep, so the sleeping stops a millisecond short of the deadline
+ * and the frame starts up to that much early. With `spin`, for measuring
+ * frame times and input latency, it stops two milliseconds short and
+ * spins to the deadline instead, at the cost of a busy core.
+ * 
+ * @param deadline The performance counter value to wait for.
+ * @param input The input queue to pump.
+ * @param spin Whether to spin for the last couple of milliseconds.
  */
-void renderText(const std::string &message, int x, int y, SDL_Color color, TTF_Font *font, SDL_Renderer *renderer) {
-    SDL_Surface *surface = TTF_RenderText_Solid(font, message.c_str(), color);
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_Rect dstRect = { x, y, surface->w, surface->h };
-    SDL_RenderCopy(renderer, texture, NULL, &dstRect);
-    SDL_FreeSurface(surface);
-    SDL_DestroyTexture(texture);
+void waitUntil(Uint64 deadline, InputQueue& input, bool spin) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 margin = frequency * (spin ? 2 : 1) / 1000;
+    for (Uint64 now = SDL_GetPerformanceCounter(); now + margin < deadline; now = SDL_GetPerformanceCounter()) {
+        SDL_Delay(1);
+        input.pump();
+    }
+    while (spin && SDL_GetPerformanceCounter() < deadline) {
+    }
+    input.pump();
 }
 
 /**
- * @brief Displays the game board, the current Tetromino, and the next Tetromino.
- * 
- * @param board The game board.
- * @param tetromino The current Tetromino.
- * @param nextTetromino The next Tetromino.
- * @param font The TTF font.
+ * @brief Sleeps until a millisecond or less before a performance counter
+ * deadline, for views that take no timed input; the next SDL_PollEvent
+ * pumps the events.
  * 
+ * @param deadline The performance counter value to wait for.
  */
-void display(const vector<vector<int>>& board, const Tetromino& tetromino, const Tetromino& nextTetromino, TTF_Font *font) {
-    // Clear the renderer
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-
-    // Calculate the board rendering area
-    int boardRenderWidth = boardWidth * BLOCK_SIZE;
-    int boardRenderHeight = (boardHeight - HIDDEN_ROWS) * BLOCK_SIZE;
-    int horizontalOffset = (SCREEN_WIDTH - boardRenderWidth) / 2;
-    int verticalOffset = -HIDDEN_ROWS * BLOCK_SIZE;
-
-    // Display the board
-    for (int y = 0; y < board.size(); y++) {
-        for (int x = 0; x < board[y].size(); x++) {
-            if (board[y][x] != 0) {
-                RGB color = getBlockColor(board[y][x]);
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Black outline
-                SDL_Rect blockOutline = { horizontalOffset + x * BLOCK_SIZE, verticalOffset + y * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-                SDL_RenderFillRect(renderer, &blockOutline);
-                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255); // Block color
-                SDL_Rect block = { horizontalOffset + x * BLOCK_SIZE + 1, verticalOffset + y * BLOCK_SIZE + 1, BLOCK_SIZE - 2, BLOCK_SIZE - 2 };
-                SDL_RenderFillRect(renderer, &block);
-            }
-        }
+void waitUntil(Uint64 deadline) {
+    Uint64 margin = SDL_GetPerformanceFrequency() / 1000;
+    for (Uint64 now = SDL_GetPerformanceCounter(); now + margin < deadline; now = SDL_GetPerformanceCounter()) {
+        SDL_Delay(1);
     }
+}
 
-    // Display the tetromino
-    for (int i = 0; i < tetromino.shape.size(); i++) {
-        for (int j = 0; j < tetromino.shape[i].size(); j++) {
-            if (tetromino.shape[i][j] != 0) {
-                RGB color = getBlockColor(tetromino.color);
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Black outline
-                SDL_Rect blockOutline = { horizontalOffset + (tetromino.x + j) * BLOCK_SIZE, verticalOffset + (tetromino.y + i) * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-                SDL_RenderFillRect(renderer, &blockOutline);
-                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255); // Block color
-                SDL_Rect block = { horizontalOffset + (tetromino.x + j) * BLOCK_SIZE + 1, verticalOffset + (tetromino.y + i) * BLOCK_SIZE + 1, BLOCK_SIZE - 2, BLOCK_SIZE - 2 };
-                SDL_RenderFillRect(renderer, &block);
-            }
-        }
+/**
+ * @brief Adds one measurement.
+ * 
+ * @param ms The duration in milliseconds.
+ */
+void TimingStats::add(double ms) {
+    if (count == 0 || ms < min) {
+        min = ms;
     }
-
-    // Draw vertical lines on either side of the board
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White color
-    SDL_Rect leftLine = { horizontalOffset - 3, 0, 3, SCREEN_HEIGHT };
-    SDL_Rect rightLine = { horizontalOffset + boardRenderWidth, 0, 3, SCREEN_HEIGHT };
-    SDL_RenderFillRect(renderer, &leftLine);
-    SDL_RenderFillRect(renderer, &rightLine);
-
-    // Display the next tetromino in the box
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // White color for the box outline
-    SDL_Rect nextPieceBox = { NEXT_PIECE_BOX_X, NEXT_PIECE_BOX_Y, NEXT_PIECE_BOX_SIZE, NEXT_PIECE_BOX_SIZE };
-    SDL_RenderDrawRect(renderer, &nextPieceBox);
-
-    int nextPieceOffsetX = NEXT_PIECE_BOX_X + (NEXT_PIECE_BOX_SIZE - nextTetromino.shape[0].size() * BLOCK_SIZE) / 2;
-    int nextPieceOffsetY = NEXT_PIECE_BOX_Y + (NEXT_PIECE_BOX_SIZE - nextTetromino.shape.size() * BLOCK_SIZE) / 2;
-
-    for (int i = 0; i < nextTetromino.shape.size(); i++) {
-        for (int j = 0; j < nextTetromino.shape[i].size(); j++) {
-            if (nextTetromino.shape[i][j] != 0) {
-                RGB color = getBlockColor(nextTetromino.color);
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Black outline
-                SDL_Rect blockOutline = { nextPieceOffsetX + j * BLOCK_SIZE, nextPieceOffsetY + i * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-                SDL_RenderFillRect(renderer, &blockOutline);
-                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255); // Block color
-                SDL_Rect block = { nextPieceOffsetX + j * BLOCK_SIZE + 1, nextPieceOffsetY + i * BLOCK_SIZE + 1, BLOCK_SIZE - 2, BLOCK_SIZE - 2 };
-                SDL_RenderFillRect(renderer, &block);
-            }
-        }
+    if (count == 0 || ms > max) {
+        max = ms;
     }
+    count++;
+    sum += ms;
+    sumSquares += ms * ms;
+}
 
-    // Render the score, lines, level, and next piece in the remaining 1/3 of the screen
-    // Example: Render a placeholder text for score
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    SDL_Rect scoreRect = { horizontalOffset + boardRenderWidth + 10, 10, SCREEN_WIDTH / 3 - 20, 50 };
-    SDL_RenderFillRect(renderer, &scoreRect);
+double TimingStats::mean() const {
+    return count > 0 ? sum / count : 0.0;
+}
 
-    SDL_Color textColor = { 0, 0, 0, 255 }; // Black color for text
-    renderText("Rows: " + std::to_string(score), horizontalOffset + boardRenderWidth + 20, 20, textColor, font, renderer);
-    renderText("Level: " + std::to_string(level), horizontalOffset + boardRenderWidth + 20, 35, textColor, font, renderer);
-    SDL_RenderPresent(renderer);
+/**
+ * @brief The standard deviation of the measurements.
+ */
+double TimingStats::deviation() const {
+    if (count == 0) {
+        return 0.0;
+    }
+    double m = mean();
+    return sqrt(std::max(0.0, sumSquares / count - m * m));
 }
 
+
 /**
- * @brief Returns a list of full rows on the board.
+ * @brief Parses the command-line options.
  * 
- * @param board The game board.
- * @return vector<int> A list of full rows.
+ * @param argc The number of command-line arguments.
+ * @param args The array of command-line arguments.
+ * @param options Receives the parsed options.
+ * @return true if every argument was recognized.
  */
-vector<int> getFullRows(const vector<vector<int>>& board) {
-    vector<int> fullRows;
-    for (int y = 0; y < board.size(); y++) {
-        bool isFull = true;
-        for (int x = 0; x < board[y].size(); x++) {
-            if (board[y][x] == 0) {
-                isFull = false;
-                break;
-            }
-        }
-        if (isFull) {
-            fullRows.push_back(y);
+bool parseOptions(int argc, char* args[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--autoplay") == 0) {
+            options.autoplay = true;
+        } else if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            options.bot.depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--threads") == 0 && hasValue) {
+            options.bot.threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "--table-mb") == 0 && hasValue) {
+            options.bot.tableMegabytes = atoi(args[++i]);
+        } else if (strcmp(args[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (strcmp(args[i], "--vsync") == 0) {
+            options.vsync = true;
+        } else if (strcmp(args[i], "--das") == 0 && hasValue) {
+            options.das = atoi(args[++i]);
+        } else if (strcmp(args[i], "--arr") == 0 && hasValue) {
+            options.arr = atoi(args[++i]);
+        } else if (strcmp(args[i], "--log-boards") == 0 && hasValue) {
+            options.logBoards = args[++i];
+        } else if (strcmp(args[i], "--profile-out") == 0 && hasValue) {
+            options.profileOut = args[++i];
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            options.seed = strtoull(args[++i], NULL, 10);
+        } else if (strcmp(args[i], "--bag") == 0) {
+            options.rules.randomizer = RANDOMIZER_BAG;
+        } else if (strcmp(args[i], "--record") == 0 && hasValue) {
+            options.record = args[++i];
+        } else if (strcmp(args[i], "--replay") == 0 && hasValue) {
+            options.replay = args[++i];
+        } else if (strcmp(args[i], "--seek") == 0 && hasValue) {
+            options.seekTick = strtoull(args[++i], NULL, 10);
+        } else if (strcmp(args[i], "--boards") == 0 && hasValue) {
+            options.boards = atoi(args[++i]);
+        } else if (strcmp(args[i], "--versus") == 0) {
+            options.versus = true;
+        } else if (strcmp(args[i], "--latency") == 0 && hasValue) {
+            options.latency = atoi(args[++i]);
+        } else if (strcmp(args[i], "--loss") == 0 && hasValue) {
+            options.loss = atoi(args[++i]);
+        } else if (strcmp(args[i], "--udp") == 0 && hasValue) {
+            options.udpPort = atoi(args[++i]);
+        } else if (strcmp(args[i], "--font") == 0 && hasValue) {
+            options.font = args[++i];
+        } else if (strcmp(args[i], "--measure-startup") == 0) {
+            options.measureStartup = true;
+        } else {
+            cout << "Usage: tetris [--autoplay] [--depth N] [--threads N] [--table-mb N] [--stats] [--vsync] [--das MS] [--arr MS]"
+                 << " [--log-boards FILE] [--profile-out FILE.csv|FILE.json] [--seed N] [--bag]"
+                 << " [--record FILE] [--replay FILE [--seek TICK]] [--boards N]"
+                 << " [--versus [--latency MS] [--loss PCT] [--udp PORT]] [--font FILE.TTF] [--measure-startup]" << endl;
+            return false;
         }
     }
-    return fullRows;
+    if (options.record != NULL && options.replay != NULL) {
+        cout << "--record and --replay cannot be combined" << endl;
+        return false;
+    }
+    if ((options.boards > 0 || options.versus) && (options.record != NULL || options.replay != NULL)) {
+        cout << "--boards and --versus cannot be combined with --record or --replay" << endl;
+        return false;
+    }
+    if (options.boards > 0 && options.versus) {
+        cout << "--boards and --versus cannot be combined" << endl;
+        return false;
+    }
+    return options.bot.depth > 0 && options.bot.threads > 0 && options.bot.tableMegabytes >= 0 && options.das >= 0 && options.arr > 0
+        && options.boards >= 0 && options.latency >= 0 && options.loss >= 0 && options.loss < 100
+        && options.udpPort >= 0 && options.udpPort < 65535;
 }
 
 
 /**
- * @brief Clears the full rows from the board.
+ * @brief Plays one game until the window is closed.
+ * 
+ * @param options The parsed command-line options.
+ * @return int Returns 0 on success, -1 if the game could not start.
  * 
- * @param board The game board.
- * @param fullRows The list of full rows to clear.
+ * Seeds the game from the clock unless --seed is given, or loads the
+ * replay given by --replay, then runs the game loop: it handles events,
+ * advances the game in fixed ticks, and renders the game interpolated
+ * between the last two ticks.
  */
-void clearFullRows(vector<vector<int>>& board, const vector<int>& fullRows) {
-    cout << "Clearing rows: ";
-    for (int row : fullRows) {
-        cout << row << " ";
+int runGame(const Options& options) {
+    // The embedded atlas needs no font file; --font, or a build without
+    // it, rasterizes the glyphs from a TrueType font here instead. Either
+    // way text is drawn from the atlas and cache afterwards.
+    TTF_Font* font = NULL;
+    if (!hasEmbeddedFont() || options.font != NULL) {
+        if (TTF_Init() == -1) {
+            cout << "SDL_ttf could not initialize! TTF_Error: " << TTF_GetError() << endl;
+            return -1;
+        }
+        font = TTF_OpenFont(options.font != NULL ? options.font : "fonts/ARIAL.TTF", FONT_SIZE);
+        if (font == NULL) {
+            cout << "Failed to load font! TTF_Error: " << TTF_GetError() << endl;
+            return -1;
+        }
+    }
+    unique_ptr<TextRenderer> text(font != NULL ? new TextRenderer(renderer, font) : new TextRenderer(renderer));
+    unique_ptr<BlockBatch> blocks(new BlockBatch(renderer, BLOCK_SIZE));
+    if (!blocks->isValid()) {
+        cout << "Failed to create block tile! SDL_Error: " << SDL_GetError() << endl;
+        return -1;
     }
-    cout << endl;
+    unique_ptr<RenderLayers> layers(new RenderLayers(renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
 
-    int lines = fullRows.size();
-    clearedRowsCount += lines; // Increment the counter by the number of cleared rows
-    linesCleared += lines;
-    score += lines * lines * 100; // Increase the score based on the number of cleared lines
+    // Per-frame render counts, summed until the next report
+    int statsFrames = 0;
+    long long statsDrawCalls = 0;
+    long long statsVertices = 0;
+    int statsLayerRedraws = 0;
+    TimingStats frameTimes;
+    TimingStats inputLatency;
 
-    if (clearedRowsCount >= level * 10) {
-        level++;
-        linesCleared -= 10;
-        dropInterval -= max(100, dropInterval - 50); // Decrease the drop interval by 50 milliseconds
-    }
+    bool quit = false;
+    SDL_Event e;
 
-    for (int row : fullRows) {
-        // Shift rows above down
-        for (int y = row; y > 0; y--) {
-            board[y] = board[y - 1];
+    GameState state;
+    uint64_t seed = options.seed != 0 ? options.seed : uint64_t(time(0));
+    state.rules = options.rules;
+    state.reset(seed);
+    state.dasTicks = options.das * TICKS_PER_SECOND / 1000;
+    state.arrTicks = max(1, options.arr * TICKS_PER_SECOND / 1000);
+
+    // A replay drives the game in place of the keyboard and the bot
+    unique_ptr<ReplayReader> player;
+    if (options.replay != NULL) {
+        player.reset(new ReplayReader());
+        if (!player->open(options.replay)) {
+            cout << "Failed to open replay " << options.replay << endl;
+            return -1;
         }
-        // Clear the top row
-        board[0] = vector<int>(board[0].size(), 0);
-    }
-
-    // Print the board state after clearing rows
-    cout << "Board state after clearing rows:" << endl;
-    for (const auto& row : board) {
-        for (int cell : row) {
-            cout << cell << " ";
+        player->restart(state);
+        if (options.seekTick > 0) {
+            Uint64 seekStart = SDL_GetPerformanceCounter();
+            uint64_t simulated = player->seek(state, options.seekTick);
+            LOG_INFO("Seeked to tick %llu, simulating %llu ticks in %.2f ms", static_cast<unsigned long long>(state.tick),
+                     static_cast<unsigned long long>(simulated), (SDL_GetPerformanceCounter() - seekStart) * 1000.0 / SDL_GetPerformanceFrequency());
         }
-        cout << endl;
     }
-}
+    ReplayWriter recorder;
+    if (options.record != NULL && !recorder.open(options.record, state, seed)) {
+        cout << "Failed to create replay " << options.record << endl;
+        return -1;
+    }
+    GameState previousState = state;
+
+    // Key events are captured with their time as SDL receives them and
+    // applied on the tick they fall in
+    unique_ptr<InputQueue> input(new InputQueue());
+    Input heldInput = INPUT_NONE;
+    Input tappedInput = INPUT_NONE;
+    Uint64 unpresentedPress = 0; // capture time of the earliest press not yet on screen
+
+    // In autoplay the bot supplies the input instead of the keyboard
+    unique_ptr<Bot> bot;
+    if (options.autoplay) {
+        bot.reset(new Bot(options.bot));
+    }
+    Uint32 lastReportTime = SDL_GetTicks();
 
+    LineClearAnimation clearAnimation;
+    ProfileOverlay profileOverlay;
 
-/**
- * @brief Flashes the full rows before clearing them.
- * 
- * @param board The game board.
- * @param fullRows The list of full rows to flash.
- * @param renderer The SDL renderer.
- * @param font The TTF font.
- * @param nextTetromino The next Tetromino to display.
- * 
- */
-void flashRows(vector<vector<int>>& board, const vector<int>& fullRows, SDL_Renderer* renderer, TTF_Font* font, const Tetromino& nextTetromino) {
-    for (int i = 0; i < FLASH_COUNT; i++) {
-        for (int row : fullRows) {
-            for (int x = 0; x < board[row].size(); x++) {
-                board[row][x] = (board[row][x] == 0) ? 1 : 0; // Toggle visibility
+    // The simulation advances in fixed ticks of the performance counter;
+    // the accumulator holds the time not yet simulated
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tickLength = frequency / TICKS_PER_SECOND;
+    const Uint64 framePeriod = frequency / FPS;
+    Uint64 accumulator = 0;
+    Uint64 previousFrameStart = SDL_GetPerformanceCounter();
+    Uint64 nextFrame = previousFrameStart + framePeriod;
+
+    while (!quit) {
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        Uint64 elapsed = frameStart - previousFrameStart;
+        previousFrameStart = frameStart;
+        if (options.stats) {
+            frameTimes.add(elapsed * 1000.0 / frequency);
+        }
+        uint64_t frameProfileStart = profileNow();
+
+        {
+            ProfileScope profile(PHASE_EVENTS);
+            while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_QUIT) {
+                    quit = true;
+                } else if (e.type == SDL_RENDER_TARGETS_RESET) {
+                    // Layer contents were lost
+                    layers->invalidate();
+                } else if (e.type == SDL_RENDER_DEVICE_RESET) {
+                    // Every texture was lost: the glyph atlas and text
+                    // cache, the block tile and the layers. Rebuild them.
+                    text.reset();
+                    text.reset(font != NULL ? new TextRenderer(renderer, font) : new TextRenderer(renderer));
+                    blocks.reset(new BlockBatch(renderer, BLOCK_SIZE));
+                    layers.reset(new RenderLayers(renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
+                    statsLayerRedraws = 0;
+                } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3 && e.key.repeat == 0) {
+                    profileOverlay.visible = !profileOverlay.visible;
+                    if (!profileEnabled()) {
+                        profileEnable(true);
+                    }
+                }
             }
         }
-        display(board, Tetromino(), nextTetromino, font); // Update the display
-        SDL_RenderPresent(renderer);
-        SDL_Delay(FLASH_INTERVAL);
-    }
-}
 
-/**
- * @brief Checks for collision between the Tetromino and the game board.
- * 
- * @param tetromino The Tetromino to check for collision.
- * @param board The game board.
- * @return true if there is a collision, false otherwise.
- */
-bool checkCollision(const Tetromino& tetromino, const vector<vector<int>>& board) {
-    for (int i = 0; i < tetromino.shape.size(); ++i) {
-        for (int j = 0; j < tetromino.shape[i].size(); ++j) {
-            if (tetromino.shape[i][j] != 0) {
-                int boardX = tetromino.x + j;
-                int boardY = tetromino.y + i;
-
-                // Check if the Tetromino is out of bounds or collides with existing blocks
-                if (boardX < 0 || boardX >= board[0].size() || boardY < 0 || boardY >= board.size() || board[boardY][boardX] != 0) {
-                    cout << "Collision detected at (" << boardX << ", " << boardY << ")" << endl;
-                    return true;
+        // After a stall, drop the time that cannot be caught up rather than
+        // running a burst of ticks
+        accumulator = min(accumulator + elapsed, tickLength * MAX_TICKS_PER_FRAME);
+        Uint64 tickEnd = frameStart - accumulator;
+        while (accumulator >= tickLength) {
+            tickEnd += tickLength;
+            Uint64 press = input->applyUntil(tickEnd, heldInput, tappedInput);
+            if (press != 0 && unpresentedPress == 0) {
+                unpresentedPress = press;
+            }
+            previousState = state;
+            if (player) {
+                ProfileScope profile(PHASE_STEP);
+                player->step(state);
+            } else {
+                Input tickInput = bot ? bot->nextInput(state) : Input(heldInput | tappedInput);
+                {
+                    ProfileScope profile(PHASE_STEP);
+                    state.step(tickInput);
                 }
+                recorder.record(state, tickInput);
             }
+            tappedInput = INPUT_NONE;
+            accumulator -= tickLength;
         }
-    }
-    return false;
-}
+        double alpha = double(accumulator) / tickLength;
 
-/**
- * @brief Handles collision detection and places the Tetromino on the board.
- * 
- * @param tetromino The Tetromino to handle.
- * @param board The game board.
- */
-bool handleCollision(Tetromino& tetromino, vector<vector<int>>& board) {
-    if (checkCollision(tetromino, board)) {
-        cout << "Collision detected at position (" << tetromino.x << ", " << tetromino.y << ")" << endl;
-        tetromino.y -= 1;
-        // Place the tetromino on the board and spawn a new one
-        for (int i = 0; i < tetromino.shape.size(); i++) {
-            for (int j = 0; j < tetromino.shape[i].size(); j++) {
-                if (tetromino.shape[i][j] != 0) {
-                    board[tetromino.y + i][tetromino.x + j] = tetromino.color;
+        // The flash runs on frame time while the game waits out its line clear delay
+        clearAnimation.update(state.pendingClear, Uint32(elapsed * 1000 / frequency));
+
+        RenderStats frameStats = display(state, previousState, alpha, *text, *blocks, *layers, clearAnimation, profileOverlay);
+        if (options.measureStartup) {
+            cout << "Startup: " << (SDL_GetPerformanceCounter() - launchTime) * 1000.0 / frequency << " ms to the first frame, "
+                 << (font != NULL ? "font file" : "embedded font") << endl;
+            quit = true;
+        }
+        if (options.stats) {
+            statsFrames++;
+            statsDrawCalls += frameStats.drawCalls;
+            statsVertices += frameStats.vertices;
+            // Time from the key press to the present that first shows its result
+            if (unpresentedPress != 0) {
+                inputLatency.add((SDL_GetPerformanceCounter() - unpresentedPress) * 1000.0 / frequency);
+            }
+        }
+        unpresentedPress = 0;
+
+        if (SDL_GetTicks() - lastReportTime >= 1000) {
+            profileOverlay.update();
+            if (bot) {
+                const BotStats& stats = bot->stats();
+                cout << "Autoplay: " << stats.searches << " searches, " << stats.nodes << " nodes, "
+                     << static_cast<long long>(stats.nodesPerSecond()) << " nodes/s on "
+                     << options.bot.threads << " threads";
+                if (options.bot.tableMegabytes > 0) {
+                    cout << ", table hit rate " << static_cast<int>(stats.hitRate() * 100) << "%";
                 }
+                cout << endl;
+            }
+            if (options.stats && statsFrames > 0) {
+                cout << "Render: " << statsFrames << " frames, "
+                     << statsDrawCalls / statsFrames << " draw calls/frame, "
+                     << statsVertices / statsFrames << " vertices/frame, "
+                     << layers->redrawCount() - statsLayerRedraws << " layer redraws" << endl;
+                cout << "Frame time: mean " << frameTimes.mean() << " ms, stddev " << frameTimes.deviation()
+                     << " ms, min " << frameTimes.min << " ms, max " << frameTimes.max << " ms" << endl;
+                if (inputLatency.count > 0) {
+                    cout << "Input latency: " << inputLatency.count << " presses, mean " << inputLatency.mean()
+                         << " ms, max " << inputLatency.max << " ms, " << input->droppedCount() << " events dropped" << endl;
+                }
+                statsLayerRedraws = layers->redrawCount();
+                frameTimes = TimingStats();
+                inputLatency = TimingStats();
+                statsFrames = 0;
+                statsDrawCalls = 0;
+                statsVertices = 0;
+            }
+            lastReportTime = SDL_GetTicks();
+        }
+
+        if (profileEnabled()) {
+            profileRecord(PHASE_FRAME, frameProfileStart, profileNow());
+        }
+
+        // With vsync, SDL_RenderPresent already waited for the display
+        if (!options.vsync) {
+            waitUntil(nextFrame, *input, options.stats);
+            nextFrame += framePeriod;
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (now > nextFrame) {
+                // Fell more than a frame behind; start a new schedule
+                nextFrame = now + framePeriod;
             }
         }
-        cout << "Tetromino placed on the board." << endl;
-        return true;
     }
-    return false;
-}
 
+    recorder.close();
+    if (player && player->diverged()) {
+        cout << "Replay diverged from its recorded piece sequence" << endl;
+    }
+    input.reset();
+    layers.reset();
+    blocks.reset();
+    text.reset();
+    if (font != NULL) {
+        TTF_CloseFont(font);
+    }
+    return 0;
+}
 
 /**
- * @brief Rotates the Tetromino if possible.
+ * @brief Shows options.boards bot games at once until the window is closed.
+ * 
+ * The games live in a GameArena stepped on a thread pool each frame and
+ * are drawn by drawWall() with blocks small enough to fit them all.
  * 
- * @param tetromino The Tetromino to rotate.
- * @param board The game board.
+ * @param options The parsed command-line options.
+ * @return int Returns 0 on success, -1 if the view could not start.
  */
-void rotateTetromino(Tetromino& tetromino, const vector<vector<int>>& board) {
-    int rows = tetromino.shape.size();
-    int cols = tetromino.shape[0].size();
-    vector<vector<int>> rotatedShape(cols, vector<int>(rows, 0));
-
-    // Transpose the matrix
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            rotatedShape[j][i] = tetromino.shape[i][j];
-        }
+int runWall(const Options& options) {
+    WallLayout layout = wallLayout(options.boards, WALL_SCREEN_WIDTH, WALL_SCREEN_HEIGHT);
+    unique_ptr<BlockBatch> blocks(new BlockBatch(renderer, layout.blockSize));
+    if (!blocks->isValid()) {
+        cout << "Failed to create block tile! SDL_Error: " << SDL_GetError() << endl;
+        return -1;
     }
 
-    // Reverse the order of the columns
-    for (int i = 0; i < cols; i++) {
-        reverse(rotatedShape[i].begin(), rotatedShape[i].end());
-    }
+    uint64_t seed = options.seed != 0 ? options.seed : uint64_t(time(0));
+    GameArena arena(options.boards, seed, options.rules, options.bot);
+    WorkStealingPool pool(options.bot.threads);
+    LOG_INFO("Showing %d boards in %d columns at %d px blocks, %zu bytes per board", options.boards, layout.columns,
+             layout.blockSize, arena.bytesPerGame());
 
-    // Save the original shape
-    vector<vector<int>> originalShape = tetromino.shape;
-    tetromino.shape = rotatedShape;
+    TimingStats stepTimes;
+    TimingStats drawTimes;
+    TimingStats frameTimes;
+    Uint32 lastReportTime = SDL_GetTicks();
+
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tickLength = frequency / TICKS_PER_SECOND;
+    const Uint64 framePeriod = frequency / FPS;
+    Uint64 accumulator = 0;
+    Uint64 previousFrameStart = SDL_GetPerformanceCounter();
+    Uint64 nextFrame = previousFrameStart + framePeriod;
+
+    bool quit = false;
+    SDL_Event e;
+    while (!quit) {
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        Uint64 elapsed = frameStart - previousFrameStart;
+        previousFrameStart = frameStart;
+        frameTimes.add(elapsed * 1000.0 / frequency);
+
+        while (SDL_PollEvent(&e) != 0) {
+            if (e.type == SDL_QUIT) {
+                quit = true;
+            } else if (e.type == SDL_RENDER_DEVICE_RESET) {
+                // The block tile was lost with every other texture
+                blocks.reset(new BlockBatch(renderer, layout.blockSize));
+            }
+        }
 
-    // Check for collisions or out of bounds
-    if (checkCollision(tetromino, board)) {
-        // Revert to the original shape if rotation is not possible
-        tetromino.shape = originalShape;
+        // Every game advances by the same whole ticks, stepped together
+        accumulator = min(accumulator + elapsed, tickLength * MAX_TICKS_PER_FRAME);
+        int ticks = int(accumulator / tickLength);
+        accumulator -= ticks * tickLength;
+        if (ticks > 0) {
+            arena.step(pool, ticks);
+        }
+        Uint64 stepEnd = SDL_GetPerformanceCounter();
+        stepTimes.add((stepEnd - frameStart) * 1000.0 / frequency);
+
+        RenderStats frameStats;
+        {
+            ProfileScope profile(PHASE_DISPLAY);
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            drawWall(&arena.game(0), arena.count(), layout, *blocks, frameStats);
+        }
+        {
+            ProfileScope profile(PHASE_PRESENT);
+            SDL_RenderPresent(renderer);
+        }
+        drawTimes.add((SDL_GetPerformanceCounter() - stepEnd) * 1000.0 / frequency);
+
+        if (SDL_GetTicks() - lastReportTime >= 1000) {
+            cout << "Wall: " << arena.count() << " boards, step mean " << stepTimes.mean() << " ms max " << stepTimes.max
+                 << " ms, draw mean " << drawTimes.mean() << " ms max " << drawTimes.max << " ms, frame mean "
+                 << frameTimes.mean() << " ms max " << frameTimes.max << " ms, " << frameStats.drawCalls << " draw calls, "
+                 << arena.bytesPerGame() << " bytes/board" << endl;
+            stepTimes = TimingStats();
+            drawTimes = TimingStats();
+            frameTimes = TimingStats();
+            lastReportTime = SDL_GetTicks();
+        }
+
+        if (!options.vsync) {
+            waitUntil(nextFrame);
+            nextFrame += framePeriod;
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (now > nextFrame) {
+                nextFrame = now + framePeriod;
+            }
+        }
     }
+    return 0;
 }
 
-
 /**
- * @brief The main function initializes the game, handles the game loop, and cleans up resources.
+ * @brief Plays the keyboard against the bot until the window is closed.
  * 
- * @param argc The number of command-line arguments.
- * @param args The array of command-line arguments.
- * @return int Returns 0 on successful execution, -1 on failure.
+ * Each side runs its own rollback session, as two machines would, joined
+ * by a link in this process or over UDP on loopback, with --latency and
+ * --loss injected on it. The keyboard's side is drawn on the left and
+ * the rollback counters are printed once a second.
  * 
- * The main function performs the following tasks:
- * - Seeds the random number generator.
- * - Initializes the game.
- * - Loads the font.
- * - Enters the main game loop where it handles events, updates game state, and renders the game.
- * - Handles game over state and displays "Game Over" message.
- * - Cleans up resources before exiting.
+ * @param options The parsed command-line options.
+ * @return int Returns 0 on success, -1 if the match could not start.
  */
-int main(int argc, char* args[]) {
-    srand(static_cast<unsigned>(time(0)));
-
-    if (!init()) {
-        cout << "Failed to initialize!" << endl;
+int runVersus(const Options& options) {
+    WallLayout layout = wallLayout(VERSUS_PLAYERS, WALL_SCREEN_WIDTH, WALL_SCREEN_HEIGHT);
+    unique_ptr<BlockBatch> blocks(new BlockBatch(renderer, layout.blockSize));
+    if (!blocks->isValid()) {
+        cout << "Failed to create block tile! SDL_Error: " << SDL_GetError() << endl;
         return -1;
     }
 
-    TTF_Font *font = TTF_OpenFont("fonts/ARIAL.TTF", 16);
-    if (font == NULL) {
-        cout << "Failed to load font! TTF_Error: " << TTF_GetError() << endl;
-        return -1;
+    LinkImpairment impairment;
+    impairment.delayTicks = (options.latency * TICKS_PER_SECOND + 500) / 1000;
+    impairment.lossPercent = options.loss;
+    unique_ptr<LocalLink> localLink(new LocalLink());
+    unique_ptr<UdpTransport> sockets[VERSUS_PLAYERS];
+    unique_ptr<ImpairedTransport> links[VERSUS_PLAYERS];
+    uint64_t seed = options.seed != 0 ? options.seed : uint64_t(time(0));
+    for (int i = 0; i < VERSUS_PLAYERS; i++) {
+        Transport* carrier = &localLink->end(i);
+        if (options.udpPort > 0) {
+            sockets[i].reset(new UdpTransport());
+            if (!sockets[i]->open(options.udpPort + i, "127.0.0.1", options.udpPort + 1 - i)) {
+                cout << "Failed to open UDP port " << options.udpPort + i << endl;
+                return -1;
+            }
+            carrier = sockets[i].get();
+        }
+        links[i].reset(new ImpairedTransport(*carrier, impairment, mixBits(seed + i)));
     }
+    unique_ptr<RollbackSession> player(new RollbackSession(0, seed, options.rules, *links[0]));
+    unique_ptr<RollbackSession> opponent(new RollbackSession(1, seed, options.rules, *links[1]));
+    unique_ptr<Bot> bot(new Bot(options.bot));
+    BotPlan plan;
+
+    unique_ptr<InputQueue> input(new InputQueue());
+    Input heldInput = INPUT_NONE;
+    Input tappedInput = INPUT_NONE;
+    uint64_t linkTick = 0;
+    bool reported = false;
+    Uint32 lastReportTime = SDL_GetTicks();
+
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tickLength = frequency / TICKS_PER_SECOND;
+    const Uint64 framePeriod = frequency / FPS;
+    Uint64 accumulator = 0;
+    Uint64 previousFrameStart = SDL_GetPerformanceCounter();
+    Uint64 nextFrame = previousFrameStart + framePeriod;
 
     bool quit = false;
-    bool gameOver = false;
     SDL_Event e;
-
-    Tetromino currentTetromino = tetrominos[rand() % tetrominos.size()];
-    Tetromino nextTetromino = tetrominos[rand() % tetrominos.size()];
-
-    Uint32 lastDropTime = SDL_GetTicks();
-
     while (!quit) {
-        Uint32 frameStart = SDL_GetTicks();
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+        Uint64 elapsed = frameStart - previousFrameStart;
+        previousFrameStart = frameStart;
 
         while (SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
                 quit = true;
-            } else if (!gameOver && e.type == SDL_KEYDOWN) {
-                switch (e.key.keysym.sym) {
-                    case SDLK_w:
-                        if (!rotateKeyPressed) {
-                            rotateTetromino(currentTetromino, board);
-                            rotateKeyPressed = true;
-                        }
-                        break;
-                    case SDLK_d:
-                        if (!rightKeyPressed) {
-                            currentTetromino.x += 1;
-                            if (checkCollision(currentTetromino, board)) {
-                                currentTetromino.x -= 1;
-                            }
-                            rightKeyPressed = true;
-                        }
-                        break;
-                    case SDLK_a:
-                        if (!leftKeyPressed) {
-                            currentTetromino.x -= 1;
-                            if (checkCollision(currentTetromino, board)) {
-                                currentTetromino.x += 1;
-                            }
-                            leftKeyPressed = true;
-                        }
-                        break;
-                    case SDLK_s:
-                        if (!downKeyPressed) {
-                            currentTetromino.y += 1;
-                            if (handleCollision(currentTetromino, board)) {
-                                vector<int> fullRows = getFullRows(board);
-                                if (!fullRows.empty()) {
-                                    cout << "before flashRows" << endl;
-                                    for (const auto& row : board) {
-                                        for (int cell : row) {
-                                            cout << cell << " ";
-                                        }
-                                        cout << endl;
-                                    }
-                                    flashRows(board, fullRows, renderer, font, nextTetromino);
-                                    clearFullRows(board, fullRows);
-                                }
-                                currentTetromino = nextTetromino;
-                                nextTetromino = tetrominos[rand() % tetrominos.size()];
-                                if (isGameOver(currentTetromino, board)) {
-                                    gameOver = true;
-                                }
-                            }
-                            downKeyPressed = true;
-                        }
-                        break;
-                }
-            } else if (e.type == SDL_KEYUP) {
-                switch (e.key.keysym.sym) {
-                    case SDLK_w:
-                        rotateKeyPressed = false;
-                        break;
-                    case SDLK_d:
-                        rightKeyPressed = false;
-                        break;
-                    case SDLK_a:
-                        leftKeyPressed = false;
-                        break;
-                    case SDLK_s:
-                        downKeyPressed = false;
-                        break;
-                }
+            } else if (e.type == SDL_RENDER_DEVICE_RESET) {
+                // The block tile was lost with every other texture
+                blocks.reset(new BlockBatch(renderer, layout.blockSize));
             }
         }
 
-        if (!gameOver) {
-            // Drop the tetromino at the defined interval
-            Uint32 currentTime = SDL_GetTicks();
-            if (currentTime - lastDropTime >= DROP_INTERVAL) {
-                currentTetromino.y += 1;
-                if (handleCollision(currentTetromino, board)) {
-                    vector<int> fullRows = getFullRows(board);
-                    if (!fullRows.empty()) {
-                        for (const auto& row : board) {
-                            for (int cell : row) {
-                                cout << cell << " ";
-                            }
-                            cout << endl;
-                        }
-                        flashRows(board, fullRows, renderer, font, nextTetromino);
-                        clearFullRows(board, fullRows);
-                    }
-                    currentTetromino = nextTetromino;
-                    nextTetromino = tetrominos[rand() % tetrominos.size()];
-                    if (isGameOver(currentTetromino, board)) {
-                        gameOver = true;
-                    }
-                }
-                lastDropTime = currentTime;
+        accumulator = min(accumulator + elapsed, tickLength * MAX_TICKS_PER_FRAME);
+        Uint64 tickEnd = frameStart - accumulator;
+        while (accumulator >= tickLength) {
+            tickEnd += tickLength;
+            input->applyUntil(tickEnd, heldInput, tappedInput);
+            for (unique_ptr<ImpairedTransport>& link : links) {
+                link->setTick(linkTick);
+            }
+            linkTick++;
+
+            player->poll();
+            if (player->advance(Input(heldInput | tappedInput))) {
+                // A tap waits out a stall rather than being lost
+                tappedInput = INPUT_NONE;
             }
+            opponent->poll();
+            BotPlan previousPlan = plan;
+            if (!opponent->advance(bot->nextInput(opponent->state().players[1], plan))) {
+                plan = previousPlan;
+            }
+            accumulator -= tickLength;
         }
 
-        display(board, currentTetromino, nextTetromino, font);
+        RenderStats frameStats;
+        {
+            ProfileScope profile(PHASE_DISPLAY);
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            drawWall(player->state().players, VERSUS_PLAYERS, layout, *blocks, frameStats);
+        }
+        {
+            ProfileScope profile(PHASE_PRESENT);
+            SDL_RenderPresent(renderer);
+        }
 
-        if (gameOver) {
-            SDL_Color textColor = { 255, 0, 0, 255 }; // Red color
-            renderText("Game Over", SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2, textColor, font, renderer);
+        const VersusState& match = player->state();
+        if (!reported && match.result() != VERSUS_PLAYING && player->confirmedTick() == player->tick()) {
+            static const char* const RESULT_TEXT[] = { "You win", "The bot wins", "Draw" };
+            cout << RESULT_TEXT[match.result()] << ": " << match.players[0].score << " to " << match.players[1].score << endl;
+            reported = true;
+        }
+        if (SDL_GetTicks() - lastReportTime >= 1000) {
+            const RollbackStats& stats = player->stats();
+            cout << "Rollback: " << stats.rollbacks << " rollbacks, " << stats.resimulatedTicks << " ticks resimulated, worst "
+                 << stats.worstRollbackTicks << " ticks in " << stats.worstResimulateNs / 1e6 << " ms, "
+                 << stats.stalls << " stalls, " << links[0]->droppedCount() + links[1]->droppedCount() << " packets dropped" << endl;
+            lastReportTime = SDL_GetTicks();
+        }
+
+        if (!options.vsync) {
+            waitUntil(nextFrame, *input, options.stats);
+            nextFrame += framePeriod;
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (now > nextFrame) {
+                nextFrame = now + framePeriod;
+            }
         }
+    }
+    return 0;
+}
+
+/**
+ * @brief The main function initializes the game, runs it, and cleans up resources.
+ * 
+ * @param argc The number of command-line arguments.
+ * @param args The array of command-line arguments.
+ * @return int Returns 0 on successful execution, -1 on failure.
+ * 
+ * The main function performs the following tasks:
+ * - Parses the command-line options.
+ * - Starts the game log and the profiler.
+ * - Initializes SDL with a window sized for one game, or for the
+ *   many-boards view when --boards or --versus is given.
+ * - Runs runGame(), runWall() or runVersus() until the window is closed.
+ * - Cleans up resources before exiting.
+ */
+int main(int argc, char* args[]) {
+    launchTime = SDL_GetPerformanceCounter();
+    Options options;
+    if (!parseOptions(argc, args, options)) {
+        return -1;
+    }
 
-        Uint32 frameTime = SDL_GetTicks() - frameStart;
-        if (frameTime < FRAME_DELAY) {
-            SDL_Delay(FRAME_DELAY - frameTime);
+
+    // Game log records are written by a background thread so they never stall a frame
+    FILE* boardLog = NULL;
+    if (options.logBoards != NULL) {
+        boardLog = fopen(options.logBoards, "wb");
+        if (boardLog == NULL) {
+            cout << "Failed to open board log " << options.logBoards << endl;
+            return -1;
         }
     }
+    logStart(stdout, boardLog);
+    // The profiler stays off, allocating nothing, until F3 or --profile-out asks for it
+    if (options.profileOut != NULL) {
+        profileEnable(true, isTracePath(options.profileOut));
+    }
+
+    bool wall = options.boards > 0 || options.versus;
+    if (!init(options.vsync, wall ? WALL_SCREEN_WIDTH : SCREEN_WIDTH, wall ? WALL_SCREEN_HEIGHT : SCREEN_HEIGHT)) {
+        cout << "Failed to initialize!" << endl;
+        return -1;
+    }
 
-    TTF_CloseFont(font);
+    int result = options.versus ? runVersus(options) : options.boards > 0 ? runWall(options) : runGame(options);
     close();
-    return 0;
-}
\ No newline at end of file
+    if (options.profileOut != NULL && !profileExport(options.profileOut)) {
+        cout << "Failed to write profile to " << options.profileOut << endl;
+    }
+    logStop();
+    if (boardLog != NULL) {
+        fclose(boardLog);
+    }
+    return result;
+}
@@ -3,49 +3,162 @@
 
 #include <SDL.h>
 #include <SDL_ttf.h>
+#include <algorithm>
 #include <vector>
+#include "arena.h"
+#include "block_batch.h"
+#include "bot.h"
+#include "game.h"
+#include "input.h"
+#include "layers.h"
+#include "profiler.h"
+#include "replay.h"
+#include "rollback.h"
+#include "text.h"
+#include <memory>
 #include <string>
 
 using namespace std;
 
 // Constants
-const int SCREEN_WIDTH = 640;
-const int SCREEN_HEIGHT = 480;
-const int BLOCK_SIZE = 24;
 const int FPS = 60;
-const int FRAME_DELAY = 1000 / FPS;
+const int MAX_TICKS_PER_FRAME = 8; // simulation ticks run at most per frame before the game slows down instead
 const int HIDDEN_ROWS = 4;
-const int DROP_INTERVAL = 500;
 const int FLASH_COUNT = 5;
 const int FLASH_INTERVAL = 150; // milliseconds
-const int NEXT_PIECE_BOX_SIZE = 120;
+static_assert(FLASH_COUNT * FLASH_INTERVAL <= LINE_CLEAR_DELAY, "The flash must fit in the line clear delay");
+static_assert(BOARD_HEIGHT > HIDDEN_ROWS, "The board needs visible rows");
+const Uint8 GHOST_ALPHA = 80; // opacity of the ghost piece, out of 255
 const int NEXT_PIECE_BOX_X = 10;
 const int NEXT_PIECE_BOX_Y = 10;
 
+// Layout, derived from the board size. The window is at least 640x480
+// and grows until a block is MIN_BLOCK_SIZE pixels; blocks shrink from
+// MAX_BLOCK_SIZE to fill it. The panels either side of the board hold
+// the next-piece box on the left and the score on the right.
+const int MIN_BLOCK_SIZE = 12;
+const int MAX_BLOCK_SIZE = 24;
+const int SIDE_PANEL_WIDTH = NEXT_PIECE_BOX_X + 5 * MAX_BLOCK_SIZE + 20;
+const int VISIBLE_ROWS = BOARD_HEIGHT - HIDDEN_ROWS;
+const int SCREEN_WIDTH = std::max(640, 2 * SIDE_PANEL_WIDTH + BOARD_WIDTH * MIN_BLOCK_SIZE);
+const int SCREEN_HEIGHT = std::max(480, VISIBLE_ROWS * MIN_BLOCK_SIZE);
+const int BLOCK_SIZE = std::min({ MAX_BLOCK_SIZE, (SCREEN_WIDTH - 2 * SIDE_PANEL_WIDTH) / BOARD_WIDTH, SCREEN_HEIGHT / VISIBLE_ROWS });
+const int NEXT_PIECE_BOX_SIZE = 5 * BLOCK_SIZE;
+
+// Board rendering area
+const int BOARD_RENDER_WIDTH = BOARD_WIDTH * BLOCK_SIZE;
+const int BOARD_OFFSET_X = (SCREEN_WIDTH - BOARD_RENDER_WIDTH) / 2;
+const int BOARD_OFFSET_Y = SCREEN_HEIGHT - BOARD_HEIGHT * BLOCK_SIZE;
+
+// Window of the many-boards view
+const int WALL_SCREEN_WIDTH = 1280;
+const int WALL_SCREEN_HEIGHT = 720;
+
 // Type definitions
 struct RGB {
     int r, g, b;
 };
 
-struct Tetromino {
-    vector<vector<int>> shape;
-    int x, y;
-    int color;
+/**
+ * @brief Flash of the rows waiting to be cleared. Advanced by elapsed
+ * frame time and drawn as an overlay; it never changes the board.
+ */
+struct LineClearAnimation {
+    RowMask rows = 0;
+    Uint32 elapsed = 0; // milliseconds since the rows appeared
+
+    void update(RowMask pendingRows, Uint32 frameTime);
+    bool rowsVisible() const;
+};
+
+/**
+ * @brief Running statistics of a duration in milliseconds, such as the
+ * time between frames.
+ */
+struct TimingStats {
+    int count = 0;
+    double sum = 0;
+    double sumSquares = 0;
+    double min = 0;
+    double max = 0;
+
+    void add(double ms);
+    double mean() const;
+    double deviation() const;
 };
 
+/**
+ * @brief Live phase timings drawn over the game, toggled with F3. The
+ * text is rebuilt once a second from that second's measurements.
+ */
+struct ProfileOverlay {
+    bool visible = false;
+    vector<string> lines;
+    unique_ptr<ProfileSnapshot> current{ new ProfileSnapshot() };
+    unique_ptr<ProfileSnapshot> previous{ new ProfileSnapshot() };
+
+    void update();
+};
+
+/**
+ * @brief Placement of the boards of the many-boards view: a grid of
+ * `columns` boards, each drawn with blocks of blockSize pixels and one
+ * block of space between neighbours, centered in the window.
+ */
+struct WallLayout {
+    int columns = 1;
+    int blockSize = 1;
+    int pitchX = 0; // pixels from one board to the next, left to right
+    int pitchY = 0; // and top to bottom
+    int originX = 0;
+    int originY = 0;
+};
+
+struct Options {
+    bool autoplay = false; // let the bot play instead of the keyboard
+    BotConfig bot;
+    bool stats = false;    // print render statistics once a second
+    bool vsync = false;    // pace frames with the display's vertical sync instead of sleeping
+    int das = DAS_DELAY;   // milliseconds before a held left or right repeats
+    int arr = ARR_DELAY;   // milliseconds between repeats
+    const char* logBoards = NULL; // file receiving packed board dumps from the log
+    const char* profileOut = NULL; // file receiving the profile at exit, CSV or Chrome trace JSON
+    uint64_t seed = 0;     // piece sequence seed; 0 seeds from the clock
+    GameRules rules;
+    const char* record = NULL; // replay file the session is recorded to
+    const char* replay = NULL; // replay file played back instead of taking input
+    uint64_t seekTick = 0;     // tick the playback fast-forwards to before it starts
+    int boards = 0;            // bot games shown at once in the many-boards view; 0 plays one game
+    bool versus = false;       // play against the bot over a rollback link
+    int latency = 0;           // one-way delay injected on the versus link, in milliseconds
+    int loss = 0;              // percent of versus packets dropped
+    int udpPort = 0;           // carry the versus link over UDP on this port and the next; 0 keeps it in process
+    const char* font = NULL;   // TrueType font loaded in place of the embedded one
+    bool measureStartup = false; // print the time from launch to the first frame shown, then exit
+};
+
+// The renderer every draw function targets, defined in render.cpp
+extern SDL_Renderer* renderer;
+
 // Function declarations
-bool init();
+bool init(bool vsync, int width, int height);
 void close();
-void renderText(const std::string &message, int x, int y, SDL_Color color, TTF_Font *font, SDL_Renderer *renderer);
-void display(const vector<vector<int>>& board, const Tetromino& currentTetromino, const Tetromino& nextTetromino, TTF_Font *font);
-vector<int> getFullRows(const vector<vector<int>>& board);
-void clearFullRows(vector<vector<int>>& board, const vector<int>& fullRows);
-void flashRows(vector<vector<int>>& board, const vector<int>& fullRows, SDL_Renderer* renderer, TTF_Font* font, const Tetromino& nextTetromino);
-bool handleCollision(Tetromino& tetromino, vector<vector<int>>& board);
-void rotateTetromino(Tetromino& tetromino, const vector<vector<int>>& board);
-bool checkCollision(const Tetromino& tetromino, const vector<vector<int>>& board);
-bool isGameOver(const Tetromino& tetromino, const vector<vector<int>>& board);
+void renderText(const std::string &message, int x, int y, SDL_Color color, TextRenderer &text);
+void drawChrome(RenderStats& stats);
+void drawBoard(const Board& board, BlockBatch& blocks, RenderStats& stats);
+void drawHud(const GameState& state, TextRenderer& text, BlockBatch& blocks, RenderStats& stats);
+void drawLineClear(const LineClearAnimation& animation, BlockBatch& blocks, RenderStats& stats);
+int fallingPieceY(const GameState& state, const GameState& previous, double alpha);
+void drawFrame(const GameState& state, const GameState& previous, double alpha, TextRenderer &text, BlockBatch &blocks, RenderLayers &layers, const LineClearAnimation &clearAnimation, RenderStats &stats);
+WallLayout wallLayout(int boards, int width, int height);
+void drawWall(const GameState* games, int count, const WallLayout& layout, BlockBatch& blocks, RenderStats& stats);
+void drawProfileOverlay(const ProfileOverlay& overlay, TextRenderer& text, RenderStats& stats);
+RenderStats display(const GameState& state, const GameState& previous, double alpha, TextRenderer &text, BlockBatch &blocks, RenderLayers &layers, const LineClearAnimation &clearAnimation, const ProfileOverlay &overlay);
+void waitUntil(Uint64 deadline, InputQueue& input, bool spin);
+void waitUntil(Uint64 deadline);
+bool parseOptions(int argc, char* args[], Options& options);
 RGB getBlockColor(int color);
+SDL_Color blockColor(int color);
 
 
 #endif // TETRIS_H
\ No newline at end of file
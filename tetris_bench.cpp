@@ -0,0 +1,456 @@
+#include "tetris.h"
+#include "evaluator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Every C++ heap allocation in the process, so benchmarks can report
+// allocations per operation. SDL's own malloc calls are not counted.
+static atomic<uint64_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Keeps benchmark results observable so the work is not optimized away
+static volatile int benchSink = 0;
+
+enum FixtureId {
+    FIXTURE_EMPTY,
+    FIXTURE_HALF_FULL,   // bottom half scattered, no full rows
+    FIXTURE_NEARLY_FULL, // most rows full but for one hole each
+    FIXTURE_MULTI_CLEAR, // four full rows under scattered rows
+    FIXTURE_COUNT
+};
+
+const char* const FIXTURE_NAMES[FIXTURE_COUNT] = { "empty", "half_full", "nearly_full", "multi_clear" };
+const int PROBE_COUNT = 256; // a power of two
+
+struct BenchOptions {
+    double minSeconds = 0.2; // run each benchmark at least this long
+    unsigned seed = 1;
+    const char* filter = NULL;
+    const char* font = "fonts/ARIAL.TTF";
+};
+
+/**
+ * @brief Prints the command-line usage of the benchmark suite.
+ */
+void printUsage() {
+    cout << "Usage: tetris_bench [options]" << endl;
+    cout << "  --quick         Short runs, for smoke testing (as run by CTest)" << endl;
+    cout << "  --min-time S    Seconds to run each benchmark for (default 0.2)" << endl;
+    cout << "  --seed N        Seed for the board fixtures and probes (default 1)" << endl;
+    cout << "  --filter TEXT   Only run benchmarks whose name contains TEXT" << endl;
+    cout << "  --font PATH     Font for the display benchmarks (default fonts/ARIAL.TTF)" << endl;
+    cout << endl;
+    cout << "Prints CSV: benchmark,fixture,iterations,ns_per_op,allocs_per_op" << endl;
+    cout << "The evaluator benchmarks count one op per board, so boards/sec is 1e9 / ns_per_op." << endl;
+    cout << "The size_ benchmarks run on boards of the size in the fixture column;" << endl;
+    cout << "size_fullRowMask and size_compactRows count one op per cell." << endl;
+    cout << "drawWall draws every board of the arena in the fixture column once per op." << endl;
+}
+
+/**
+ * @brief Fills a row with random colors, leaving one random hole unless full is set.
+ */
+template <int W, int H>
+void fillRow(BasicBoard<W, H>& board, int y, bool full, mt19937& random) {
+    int hole = full ? -1 : int(random() % W);
+    for (int x = 0; x < W; x++) {
+        if (x != hole) {
+            setCell(board, x, y, 1 + int(random() % PIECE_COUNT));
+        }
+    }
+}
+
+/**
+ * @brief Builds a reproducible board fixture.
+ *
+ * @param id The fixture to build.
+ * @param seed The seed; the same seed always gives the same board.
+ */
+Board makeFixture(int id, unsigned seed) {
+    mt19937 random(seed * FIXTURE_COUNT + id);
+    Board board;
+    clearBoard(board);
+    switch (id) {
+    case FIXTURE_HALF_FULL:
+        for (int y = BOARD_HEIGHT / 2; y < BOARD_HEIGHT; y++) {
+            for (int x = 0; x < BOARD_WIDTH; x++) {
+                if (random() % 10 < 6) {
+                    setCell(board, x, y, 1 + int(random() % PIECE_COUNT));
+                }
+            }
+            if (board.rows[y] == FULL_ROW) {
+                int hole = int(random() % BOARD_WIDTH);
+                board.rows[y] &= RowBits(~(RowBits(1) << hole));
+                board.colors[y][hole] = 0;
+            }
+        }
+        rebuildBoardIndex(board);
+        break;
+    case FIXTURE_NEARLY_FULL:
+        for (int y = 6; y < BOARD_HEIGHT; y++) {
+            fillRow(board, y, false, random);
+        }
+        break;
+    case FIXTURE_MULTI_CLEAR:
+        for (int y = BOARD_HEIGHT / 2; y < BOARD_HEIGHT; y++) {
+            fillRow(board, y, y >= BOARD_HEIGHT - 4, random);
+        }
+        break;
+    default:
+        break;
+    }
+    return board;
+}
+
+/**
+ * @brief Pieces at random types, rotations and positions, some in bounds
+ * and some not, for the collision and rotation benchmarks.
+ */
+vector<Tetromino> makeProbes(unsigned seed, int width = BOARD_WIDTH, int height = BOARD_HEIGHT) {
+    mt19937 random(seed);
+    vector<Tetromino> probes(PROBE_COUNT);
+    for (Tetromino& probe : probes) {
+        probe.type = int(random() % PIECE_COUNT);
+        probe.rotation = int(random() % ROTATION_COUNT);
+        probe.x = int(random() % (width + 2)) - 2;
+        probe.y = int(random() % height);
+    }
+    return probes;
+}
+
+/**
+ * @brief Every resting placement of every piece on the board, moved down
+ * one row so handleCollision always locks it.
+ */
+vector<Tetromino> makeLandings(const Board& board) {
+    vector<Tetromino> landings;
+    Tetromino placements[MAX_PLACEMENTS];
+    for (int type = 0; type < PIECE_COUNT; type++) {
+        int count = findPlacements(board, type, placements);
+        for (int i = 0; i < count; i++) {
+            placements[i].y += 1;
+            landings.push_back(placements[i]);
+        }
+    }
+    return landings;
+}
+
+/**
+ * @brief Times an operation and prints one CSV row.
+ *
+ * The iteration count grows until a run lasts at least the minimum time;
+ * that run is reported.
+ *
+ * @param name The benchmark name.
+ * @param fixture The fixture name.
+ * @param options The benchmark options.
+ * @param op Called with the iteration index.
+ * @param itemsPerCall Operations each call performs; results are per operation.
+ */
+template <typename Op>
+void runBenchmark(const char* name, const char* fixture, const BenchOptions& options, Op op, int itemsPerCall = 1) {
+    if (options.filter != NULL && strstr(name, options.filter) == NULL) {
+        return;
+    }
+    op(0); // warm up caches and any lazily built state
+
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t allocationsBefore = allocationCount.load(memory_order_relaxed);
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            op(i);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        uint64_t allocations = allocationCount.load(memory_order_relaxed) - allocationsBefore;
+
+        if (seconds >= options.minSeconds || iterations >= (uint64_t(1) << 34)) {
+            uint64_t operations = iterations * itemsPerCall;
+            printf("%s,%s,%llu,%.2f,%.3f\n", name, fixture, static_cast<unsigned long long>(operations),
+                   seconds * 1e9 / operations, double(allocations) / operations);
+            fflush(stdout);
+            return;
+        }
+        // Aim past the minimum time so the next run is usually the last
+        double scale = seconds > 0 ? options.minSeconds * 1.5 / seconds : 100.0;
+        iterations = uint64_t(iterations * min(100.0, max(2.0, scale)));
+    }
+}
+
+/**
+ * @brief Benchmarks the core board functions on one fixture.
+ */
+void benchCore(const Board& board, const char* fixture, const vector<Tetromino>& probes, const BenchOptions& options) {
+    vector<Tetromino> landings = makeLandings(board);
+
+    runBenchmark("checkCollision", fixture, options, [&](uint64_t i) {
+        benchSink += checkCollision(probes[i & (PROBE_COUNT - 1)], board);
+    });
+    runBenchmark("getFullRows", fixture, options, [&](uint64_t) {
+        benchSink += int(getFullRows(board));
+    });
+    // The mutating benchmarks work on a copy; board_copy is that copy alone
+    runBenchmark("board_copy", fixture, options, [&](uint64_t) {
+        Board work = board;
+        benchSink += work.rows[BOARD_HEIGHT - 1];
+    });
+    runBenchmark("clearFullRows", fixture, options, [&](uint64_t) {
+        Board work = board;
+        benchSink += clearFullRows(work, getFullRows(work));
+    });
+    runBenchmark("rotateTetromino", fixture, options, [&](uint64_t i) {
+        Tetromino tetromino = probes[i & (PROBE_COUNT - 1)];
+        rotateTetromino(tetromino, board);
+        benchSink += tetromino.rotation;
+    });
+    if (!landings.empty()) {
+        runBenchmark("handleCollision", fixture, options, [&](uint64_t i) {
+            Board work = board;
+            Tetromino tetromino = landings[i % landings.size()];
+            benchSink += handleCollision(tetromino, work);
+        });
+    }
+}
+
+/**
+ * @brief Benchmarks evaluating the boards left by every placement on a
+ * fixture, one board at a time with boardFeatures() and as one batch
+ * with each evaluator kernel the CPU supports. Times are per board.
+ */
+void benchEvaluator(const Board& board, const char* fixture, const BenchOptions& options) {
+    vector<Board> boards;
+    Tetromino placements[MAX_PLACEMENTS];
+    for (int type = 0; type < PIECE_COUNT && int(boards.size()) < BATCH_SIZE; type++) {
+        int count = findPlacements(board, type, placements);
+        for (int i = 0; i < count && int(boards.size()) < BATCH_SIZE; i++) {
+            Board next = board;
+            applyPlacement(next, placements[i]);
+            boards.push_back(next);
+        }
+    }
+    if (boards.empty()) {
+        return;
+    }
+    BoardBatch batch;
+    for (const Board& next : boards) {
+        batch.add(next);
+    }
+    int count = int(boards.size());
+
+    runBenchmark("boardFeatures", fixture, options, [&](uint64_t) {
+        for (const Board& next : boards) {
+            benchSink += boardFeatures(next, 0).holes;
+        }
+    }, count);
+    BatchFeatures features;
+    for (int kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        if (!kernelSupported(EvaluatorKernel(kernel))) {
+            continue;
+        }
+        string name = string("evaluateBatch_") + KERNEL_NAMES[kernel];
+        runBenchmark(name.c_str(), fixture, options, [&](uint64_t) {
+            evaluateBatch(batch, features, EvaluatorKernel(kernel));
+            benchSink += features.holes[0];
+        }, count);
+    }
+}
+
+/**
+ * @brief Benchmarks the board primitives on a W x H board laid out like
+ * the multi_clear fixture. Collision tests are timed per probe; the
+ * full-row scan and the compaction per cell, so a time that falls as the
+ * board widens means work per row stays flat while rows hold more cells.
+ */
+template <int W, int H>
+void benchBoardSize(const BenchOptions& options) {
+    char size[16];
+    snprintf(size, sizeof(size), "%dx%d", W, H);
+    mt19937 random(options.seed);
+    BasicBoard<W, H> board;
+    clearBoard(board);
+    for (int y = H / 2; y < H; y++) {
+        fillRow(board, y, y >= H - 4, random);
+    }
+    vector<Tetromino> probes = makeProbes(options.seed, W, H);
+
+    runBenchmark("size_collides", size, options, [&](uint64_t i) {
+        const Tetromino& probe = probes[i & (PROBE_COUNT - 1)];
+        benchSink += collides(board, pieceShape(probe).rows, PIECE_BOX_SIZE, probe.x, probe.y);
+    });
+    runBenchmark("size_fullRowMask", size, options, [&](uint64_t) {
+        benchSink += int(fullRowMask(board));
+    }, W * H);
+    runBenchmark("size_compactRows", size, options, [&](uint64_t) {
+        BasicBoard<W, H> work = board;
+        benchSink += compactRows(work, fullRowMask(work));
+    }, W * H);
+}
+
+/**
+ * @brief Benchmarks display() on an offscreen software renderer, once
+ * with the cached layers in their steady state and once redrawing every
+ * layer.
+ */
+void benchDisplay(const Board& board, const char* fixture, TextRenderer& text, BlockBatch& blocks, RenderLayers& layers, const BenchOptions& options) {
+    GameState state;
+    state.reset(options.seed);
+    state.board = board;
+    GameState previous = state;
+    LineClearAnimation clearAnimation;
+    ProfileOverlay overlay;
+
+    runBenchmark("display", fixture, options, [&](uint64_t) {
+        benchSink += display(state, previous, 0.5, text, blocks, layers, clearAnimation, overlay).drawCalls;
+    });
+    runBenchmark("display_uncached", fixture, options, [&](uint64_t) {
+        layers.invalidate();
+        benchSink += display(state, previous, 0.5, text, blocks, layers, clearAnimation, overlay).drawCalls;
+    });
+}
+
+/**
+ * @brief Benchmarks building the glyph atlas, from the font file as a
+ * build without the embedded font does at startup, and from the
+ * embedded atlas when there is one.
+ */
+void benchTextAtlas(const BenchOptions& options) {
+    runBenchmark("text_atlas", "font_file", options, [&](uint64_t) {
+        TTF_Font* font = TTF_OpenFont(options.font, FONT_SIZE);
+        if (font != NULL) {
+            TextRenderer text(renderer, font);
+            benchSink += text.lineHeight();
+            TTF_CloseFont(font);
+        }
+    });
+    if (hasEmbeddedFont()) {
+        runBenchmark("text_atlas", "embedded", options, [&](uint64_t) {
+            TextRenderer text(renderer);
+            benchSink += text.lineHeight();
+        });
+    }
+}
+
+/**
+ * @brief Benchmarks drawWall() on an offscreen software renderer for an
+ * arena of bot games, advanced far enough that the boards have stacks.
+ */
+void benchWall(int boards, const BenchOptions& options) {
+    if (options.filter != NULL && strstr("drawWall", options.filter) == NULL) {
+        return; // skip playing the games
+    }
+    GameArena arena(boards, options.seed, GameRules(), BotConfig());
+    WorkStealingPool pool(1);
+    arena.step(pool, 600);
+    WallLayout layout = wallLayout(boards, SCREEN_WIDTH, SCREEN_HEIGHT);
+    BlockBatch blocks(renderer, layout.blockSize);
+    string fixture = to_string(boards) + "_boards";
+
+    runBenchmark("drawWall", fixture.c_str(), options, [&](uint64_t) {
+        RenderStats stats;
+        drawWall(&arena.game(0), arena.count(), layout, blocks, stats);
+        benchSink += stats.drawCalls;
+    });
+}
+
+/**
+ * @brief Runs every benchmark against every fixture and prints the results as CSV.
+ */
+int main(int argc, char* args[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--quick") == 0) {
+            options.minSeconds = 0.01;
+        } else if (strcmp(args[i], "--min-time") == 0 && hasValue) {
+            options.minSeconds = atof(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            options.seed = unsigned(strtoul(args[++i], NULL, 10));
+        } else if (strcmp(args[i], "--filter") == 0 && hasValue) {
+            options.filter = args[++i];
+        } else if (strcmp(args[i], "--font") == 0 && hasValue) {
+            options.font = args[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    Board fixtures[FIXTURE_COUNT];
+    for (int id = 0; id < FIXTURE_COUNT; id++) {
+        fixtures[id] = makeFixture(id, options.seed);
+    }
+    vector<Tetromino> probes = makeProbes(options.seed);
+
+    printf("benchmark,fixture,iterations,ns_per_op,allocs_per_op\n");
+    for (int id = 0; id < FIXTURE_COUNT; id++) {
+        benchCore(fixtures[id], FIXTURE_NAMES[id], probes, options);
+        benchEvaluator(fixtures[id], FIXTURE_NAMES[id], options);
+    }
+    benchBoardSize<10, 24>(options);
+    benchBoardSize<16, 24>(options);
+    benchBoardSize<32, 24>(options);
+    benchBoardSize<64, 24>(options);
+
+    // The display path draws into a surface in memory, so no window or GPU is needed
+    if (TTF_Init() == -1) {
+        cerr << "SDL_ttf could not initialize! TTF_Error: " << TTF_GetError() << endl;
+        return 1;
+    }
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+    renderer = surface != NULL ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (renderer == NULL) {
+        cerr << "Software renderer could not be created! SDL_Error: " << SDL_GetError() << endl;
+        return 1;
+    }
+    TTF_Font* font = TTF_OpenFont(options.font, FONT_SIZE);
+    if (font == NULL) {
+        cerr << "Failed to load font! TTF_Error: " << TTF_GetError() << endl;
+        return 1;
+    }
+    {
+        TextRenderer text(renderer, font);
+        BlockBatch blocks(renderer, BLOCK_SIZE);
+        RenderLayers layers(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+        for (int id = 0; id < FIXTURE_COUNT; id++) {
+            benchDisplay(fixtures[id], FIXTURE_NAMES[id], text, blocks, layers, options);
+        }
+    }
+    benchTextAtlas(options);
+    benchWall(64, options);
+    benchWall(256, options);
+
+    TTF_CloseFont(font);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    TTF_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,856 @@
+#include "arena.h"
+#include "bot.h"
+#include "game.h"
+#include "movegen.h"
+#include "replay.h"
+#include "rollback.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @brief Prints the command-line usage of the headless simulator.
+ */
+void printUsage() {
+    cout << "Usage: tetris_sim <command> [options]" << endl;
+    cout << endl;
+    cout << "Commands:" << endl;
+    cout << "  autoplay   Let the bot play and report search throughput" << endl;
+    cout << "    --pieces N         Pieces to play per run (default 200)" << endl;
+    cout << "    --depth N          Pieces searched ahead (default 2)" << endl;
+    cout << "    --threads A,B,...  Thread counts to compare (default 1)" << endl;
+    cout << "    --seed N           Random seed (default 1)" << endl;
+    cout << "    --table-mb A,B,... Transposition table sizes to compare, 0 for none (default 0)" << endl;
+    cout << "    --replace POLICY   Table replacement: depth (default) or always" << endl;
+    cout << "    --record FILE      Record the game to a replay file" << endl;
+    cout << "  batch      Play many independent seeded games in parallel and report distributions" << endl;
+    cout << "    --games N          Games to play (default 100)" << endl;
+    cout << "    --pieces N         Piece limit per game (default 1000)" << endl;
+    cout << "    --depth N          Pieces the bot searches ahead (default 1)" << endl;
+    cout << "    --threads N        Games played at once (default: all cores)" << endl;
+    cout << "    --seed N           Base seed; game i uses a seed derived from it and i (default 1)" << endl;
+    cout << "    --bag              Use the 7-bag randomizer instead of uniform pieces" << endl;
+    cout << "    --scoring RULE     square (default), nes or guideline" << endl;
+    cout << "    --leveling RULE    ten (every 10 lines, default), variable (5 * level) or none" << endl;
+    cout << "  replay FILE  Fast-forward a replay without rendering and report the game at the end" << endl;
+    cout << "    --to TICK          Stop at this tick instead of the end" << endl;
+    cout << "    --no-keyframes     Simulate every tick from the start instead of seeking" << endl;
+    cout << "  arena      Step many bot games at once, 60 frames of game time a second, and find how many fit" << endl;
+    cout << "             in a frame; without --boards the count doubles from 16, then is narrowed down" << endl;
+    cout << "    --boards A,B,...   Board counts to measure" << endl;
+    cout << "    --threads N        Threads stepping the games (default: all cores)" << endl;
+    cout << "    --depth N          Pieces the bot searches ahead (default 1)" << endl;
+    cout << "    --seconds N        Game seconds to run each count for (default 10)" << endl;
+    cout << "    --seed N           Base seed (default 1)" << endl;
+    cout << "  versus     Play two bots against each other over a rollback link and report the rollback cost" << endl;
+    cout << "    --latency A,B,...  One-way delays in milliseconds to compare (default 0,25,50,100,200)" << endl;
+    cout << "    --jitter MS        Up to this much more delay per packet, at random (default 0)" << endl;
+    cout << "    --loss PCT         Percent of packets dropped (default 0)" << endl;
+    cout << "    --seconds N        Game seconds to play (default 60)" << endl;
+    cout << "    --depth N          Pieces the bots search ahead (default 1)" << endl;
+    cout << "    --seed N           Match seed (default 1)" << endl;
+    cout << "    --udp PORT         Send over UDP on 127.0.0.1 ports PORT and PORT+1 instead of in process" << endl;
+    cout << "  perft      Count the placement sequences of a seeded position to each depth, single-threaded" << endl;
+    cout << "             and split across threads at the root, and report nodes/s" << endl;
+    cout << "    --depth N          Deepest depth counted (default 3)" << endl;
+    cout << "    --rows N           Bottom rows filled at random, with overhangs to tuck under (default 8)" << endl;
+    cout << "    --pieces LETTERS   Piece sequence, e.g. TSZ (default: random from the seed)" << endl;
+    cout << "    --threads N        Threads for the root split (default: all cores)" << endl;
+    cout << "    --seed N           Seed of the board and the pieces (default 1)" << endl;
+}
+
+/**
+ * @brief Parses a comma-separated list of integers.
+ *
+ * @param text The list, e.g. "1,2,4,8".
+ * @param minimum The smallest valid value.
+ * @return vector<int> The values, or an empty vector if any entry is invalid.
+ */
+vector<int> parseIntList(const char* text, int minimum = 1) {
+    vector<int> values;
+    const char* p = text;
+    while (*p) {
+        char* end;
+        long value = strtol(p, &end, 10);
+        if (end == p || value < minimum) {
+            return vector<int>();
+        }
+        values.push_back(int(value));
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return values;
+}
+
+/**
+ * @brief Plays seeded games with the bot once per table size and thread
+ * count and reports how search throughput scales.
+ *
+ * The transposition table columns give the share of lookups it answered,
+ * the placements those answers did not search again, and how much less
+ * search time the run took than the first row.
+ */
+int runAutoplay(int argc, char* args[]) {
+    int pieces = 200;
+    int seed = 1;
+    BotConfig config;
+    vector<int> threadCounts = { 1 };
+    vector<int> tableSizes = { 0 };
+    const char* recordPath = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--pieces") == 0 && hasValue) {
+            pieces = atoi(args[++i]);
+        } else if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            config.depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--threads") == 0 && hasValue) {
+            threadCounts = parseIntList(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            seed = atoi(args[++i]);
+        } else if (strcmp(args[i], "--record") == 0 && hasValue) {
+            recordPath = args[++i];
+        } else if (strcmp(args[i], "--table-mb") == 0 && hasValue) {
+            tableSizes = parseIntList(args[++i], 0);
+        } else if (strcmp(args[i], "--replace") == 0 && hasValue) {
+            i++;
+            if (strcmp(args[i], "depth") == 0) {
+                config.replacement = REPLACE_DEPTH_PREFERRED;
+            } else if (strcmp(args[i], "always") == 0) {
+                config.replacement = REPLACE_ALWAYS;
+            } else {
+                printUsage();
+                return 1;
+            }
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (pieces <= 0 || config.depth <= 0 || threadCounts.empty() || tableSizes.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    cout << "table_mb,threads,pieces,score,nodes,seconds,nodes_per_sec,speedup,hit_rate,nodes_saved,time_saved" << endl;
+    double baseline = 0;
+    double baselineSeconds = 0;
+    for (int tableSize : tableSizes) {
+        for (int threads : threadCounts) {
+            config.threads = threads;
+            config.tableMegabytes = tableSize;
+            Bot bot(config);
+            GameState state;
+            state.reset(seed);
+            // Every run plays the same game, so each rewrites the same replay
+            ReplayWriter replay;
+            if (recordPath != NULL && !replay.open(recordPath, state, uint64_t(seed))) {
+                cout << "Failed to create replay " << recordPath << endl;
+                return 1;
+            }
+            while (!state.gameOver && state.pieceCount <= pieces) {
+                Input input = bot.nextInput(state);
+                state.step(input);
+                replay.record(state, input);
+            }
+
+            const BotStats& stats = bot.stats();
+            if (baseline == 0) {
+                baseline = stats.nodesPerSecond();
+                baselineSeconds = stats.seconds;
+            }
+            cout << tableSize << "," << threads << "," << stats.searches << "," << state.score << "," << stats.nodes << ","
+                 << fixed << setprecision(4) << stats.seconds << ","
+                 << setprecision(0) << stats.nodesPerSecond() << ","
+                 << setprecision(2) << (baseline > 0 ? stats.nodesPerSecond() / baseline : 0) << ","
+                 << setprecision(4) << stats.hitRate() << "," << stats.nodesSaved << ","
+                 << setprecision(1) << (baselineSeconds > 0 ? 100 * (1 - stats.seconds / baselineSeconds) : 0) << "%" << endl;
+            cout.unsetf(ios::floatfield);
+        }
+    }
+    return 0;
+}
+
+// Outcome of one batch game
+struct GameResult {
+    int score;
+    int lines;
+    int level;
+    int pieces; // pieces placed
+};
+
+/**
+ * @brief Derives the seed of one game in a batch from the base seed.
+ */
+uint64_t batchGameSeed(uint64_t seed, int game) {
+    return seed ^ (uint64_t(game) * 0xD1B54A32D192ED03ull);
+}
+
+/**
+ * @brief Plays one seeded game with a single-threaded bot until it tops
+ * out or reaches the piece limit.
+ */
+GameResult playBatchGame(uint64_t seed, const GameRules& rules, int depth, int pieceLimit) {
+    BotConfig config;
+    config.depth = depth;
+    config.threads = 1;
+    Bot bot(config);
+    GameState state;
+    state.rules = rules;
+    state.reset(seed);
+    while (!state.gameOver && state.pieceCount <= pieceLimit) {
+        state.step(bot.nextInput(state));
+    }
+    // pieceCount includes the piece in play, or the one that could not spawn
+    return { state.score, state.clearedRowsCount, state.level, state.pieceCount - 1 };
+}
+
+/**
+ * @brief Prints mean, standard deviation and percentiles of one metric as a CSV row.
+ */
+void printDistribution(const char* name, vector<double> values) {
+    sort(values.begin(), values.end());
+    double sum = 0;
+    double sumSquares = 0;
+    for (double value : values) {
+        sum += value;
+        sumSquares += value * value;
+    }
+    size_t count = values.size();
+    double mean = sum / count;
+    double deviation = sqrt(max(0.0, sumSquares / count - mean * mean));
+    auto percentile = [&](double p) { return values[min(count - 1, size_t(p * count))]; };
+    cout << name << "," << fixed << setprecision(2) << mean << "," << deviation << ","
+         << setprecision(0) << values.front() << "," << percentile(0.1) << "," << percentile(0.5) << ","
+         << percentile(0.9) << "," << values.back() << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+/**
+ * @brief Plays a batch of independent seeded games across a thread pool and
+ * reports score, line and level distributions and games per second.
+ *
+ * Each game owns its PRNG and bot, and results are stored by game index
+ * and reduced in that order, so the output apart from timing is identical
+ * for a given seed whatever the thread count.
+ */
+int runBatch(int argc, char* args[]) {
+    int games = 100;
+    int pieces = 1000;
+    int depth = 1;
+    int threads = max(1, int(thread::hardware_concurrency()));
+    uint64_t seed = 1;
+    GameRules rules;
+
+    for (int i = 0; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--games") == 0 && hasValue) {
+            games = atoi(args[++i]);
+        } else if (strcmp(args[i], "--pieces") == 0 && hasValue) {
+            pieces = atoi(args[++i]);
+        } else if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--threads") == 0 && hasValue) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(args[++i], NULL, 10);
+        } else if (strcmp(args[i], "--bag") == 0) {
+            rules.randomizer = RANDOMIZER_BAG;
+        } else if (strcmp(args[i], "--scoring") == 0 && hasValue) {
+            const char* rule = args[++i];
+            if (strcmp(rule, "square") == 0) {
+                rules.scoring = SCORING_SQUARE;
+            } else if (strcmp(rule, "nes") == 0) {
+                rules.scoring = SCORING_NES;
+            } else if (strcmp(rule, "guideline") == 0) {
+                rules.scoring = SCORING_GUIDELINE;
+            } else {
+                printUsage();
+                return 1;
+            }
+        } else if (strcmp(args[i], "--leveling") == 0 && hasValue) {
+            const char* rule = args[++i];
+            if (strcmp(rule, "ten") == 0) {
+                rules.leveling = LEVELING_TEN_LINES;
+            } else if (strcmp(rule, "variable") == 0) {
+                rules.leveling = LEVELING_VARIABLE_GOAL;
+            } else if (strcmp(rule, "none") == 0) {
+                rules.leveling = LEVELING_NONE;
+            } else {
+                printUsage();
+                return 1;
+            }
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (games <= 0 || pieces <= 0 || depth <= 0 || threads <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    vector<GameResult> results(games);
+    auto start = chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads);
+        TaskGroup group;
+        for (int game = 0; game < games; game++) {
+            pool.submit(group, [&, game] {
+                results[game] = playBatchGame(batchGameSeed(seed, game), rules, depth, pieces);
+            });
+        }
+        pool.wait(group);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // FNV-1a over the results in game order, to compare runs at a glance
+    uint64_t checksum = 0xCBF29CE484222325ull;
+    vector<double> scores, lines, levels, pieceCounts;
+    map<int, int> levelCounts;
+    for (const GameResult& result : results) {
+        for (int value : { result.score, result.lines, result.level, result.pieces }) {
+            checksum = (checksum ^ uint32_t(value)) * 0x100000001B3ull;
+        }
+        scores.push_back(result.score);
+        lines.push_back(result.lines);
+        levels.push_back(result.level);
+        pieceCounts.push_back(result.pieces);
+        levelCounts[result.level]++;
+    }
+
+    cout << "games,threads,seconds,games_per_sec,checksum" << endl;
+    cout << games << "," << threads << "," << fixed << setprecision(4) << seconds << ","
+         << setprecision(1) << games / seconds << "," << hex << setw(16) << setfill('0') << checksum << endl;
+    cout << dec << setfill(' ');
+    cout.unsetf(ios::floatfield);
+    cout << endl;
+    cout << "metric,mean,stddev,min,p10,p50,p90,max" << endl;
+    printDistribution("score", scores);
+    printDistribution("lines", lines);
+    printDistribution("level", levels);
+    printDistribution("pieces", pieceCounts);
+    cout << endl;
+    cout << "level,games" << endl;
+    for (const auto& entry : levelCounts) {
+        cout << entry.first << "," << entry.second << endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fast-forwards a replay at full simulation speed and reports
+ * where the game ends up, how long it took, and whether the replay
+ * diverged from its recorded piece sequence.
+ */
+int runReplay(int argc, char* args[]) {
+    if (argc < 1) {
+        printUsage();
+        return 1;
+    }
+    const char* path = args[0];
+    uint64_t target = UINT64_MAX;
+    bool useKeyframes = true;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--to") == 0 && hasValue) {
+            target = strtoull(args[++i], NULL, 10);
+        } else if (strcmp(args[i], "--no-keyframes") == 0) {
+            useKeyframes = false;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    ReplayReader replay;
+    if (!replay.open(path)) {
+        cout << "Failed to open replay " << path << endl;
+        return 1;
+    }
+    GameState state;
+    replay.restart(state);
+    auto start = chrono::steady_clock::now();
+    uint64_t simulated = replay.seek(state, target, useKeyframes);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "bytes,end_tick,keyframes,tick,ticks_simulated,seconds,ticks_per_sec,score,lines,level,pieces,game_over,diverged" << endl;
+    cout << replay.fileSize() << "," << replay.endTick() << "," << replay.keyframeCount() << ","
+         << state.tick << "," << simulated << "," << fixed << setprecision(6) << seconds << ","
+         << setprecision(0) << (seconds > 0 ? simulated / seconds : 0) << ","
+         << state.score << "," << state.clearedRowsCount << "," << state.level << "," << state.pieceCount << ","
+         << (state.gameOver ? 1 : 0) << "," << (replay.diverged() ? 1 : 0) << endl;
+    cout.unsetf(ios::floatfield);
+    return replay.diverged() ? 2 : 0;
+}
+
+// Frames per second the arena benchmark holds the games to
+const int ARENA_FPS = 60;
+
+// Frame times of one arena benchmark run
+struct ArenaRun {
+    int boards;
+    int frames;
+    double meanMs;
+    double p99Ms;
+    double maxMs;
+    size_t bytesPerBoard;
+};
+
+/**
+ * @brief Steps an arena of bot games one frame's worth of ticks at a
+ * time, as fast as it goes, and times each frame.
+ */
+ArenaRun measureArena(int boards, int threads, const BotConfig& config, uint64_t seed, int seconds) {
+    GameArena arena(boards, seed, GameRules(), config);
+    WorkStealingPool pool(threads);
+    vector<double> frameMs;
+    int frames = seconds * ARENA_FPS;
+    for (int frame = 0; frame < frames; frame++) {
+        // Spread the odd ticks of a second over its frames
+        int ticks = (frame + 1) * TICKS_PER_SECOND / ARENA_FPS - frame * TICKS_PER_SECOND / ARENA_FPS;
+        auto start = chrono::steady_clock::now();
+        arena.step(pool, ticks);
+        frameMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    sort(frameMs.begin(), frameMs.end());
+    double sum = 0;
+    for (double ms : frameMs) {
+        sum += ms;
+    }
+    return { boards, frames, sum / frames, frameMs[min(frameMs.size() - 1, frameMs.size() * 99 / 100)],
+             frameMs.back(), arena.bytesPerGame() };
+}
+
+/**
+ * @brief Finds how many bot games the core can step at 60 frames per
+ * second, and reports the memory each takes.
+ *
+ * A board count fits when 99% of its frames are stepped within the frame
+ * period. Drawing is not included; tetris_bench times drawWall separately.
+ */
+int runArena(int argc, char* args[]) {
+    vector<int> boardCounts;
+    int threads = max(1, int(thread::hardware_concurrency()));
+    int seconds = 10;
+    uint64_t seed = 1;
+    BotConfig config;
+    config.depth = 1;
+
+    for (int i = 0; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--boards") == 0 && hasValue) {
+            boardCounts = parseIntList(args[++i]);
+            if (boardCounts.empty()) {
+                printUsage();
+                return 1;
+            }
+        } else if (strcmp(args[i], "--threads") == 0 && hasValue) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            config.depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seconds") == 0 && hasValue) {
+            seconds = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(args[++i], NULL, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (threads <= 0 || config.depth <= 0 || seconds <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    const double budgetMs = 1000.0 / ARENA_FPS;
+    int best = 0;
+    cout << "boards,threads,frames,mean_ms,p99_ms,max_ms,bytes_per_board,fits_60fps" << endl;
+    auto run = [&](int boards) {
+        ArenaRun result = measureArena(boards, threads, config, seed, seconds);
+        bool fits = result.p99Ms <= budgetMs;
+        cout << boards << "," << threads << "," << result.frames << "," << fixed << setprecision(3)
+             << result.meanMs << "," << result.p99Ms << "," << result.maxMs << "," << result.bytesPerBoard << ","
+             << (fits ? 1 : 0) << endl;
+        cout.unsetf(ios::floatfield);
+        if (fits) {
+            best = max(best, boards);
+        }
+        return fits;
+    };
+
+    if (!boardCounts.empty()) {
+        for (int boards : boardCounts) {
+            run(boards);
+        }
+    } else {
+        // Double until a count misses the frame, then bisect to within 1/16
+        int low = 0, high = 16;
+        while (run(high)) {
+            low = high;
+            high *= 2;
+        }
+        while (high - low > max(1, low / 16)) {
+            int middle = (low + high) / 2;
+            if (run(middle)) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+    }
+    cout << endl;
+    cout << "max_boards_at_60fps," << best << endl;
+    return 0;
+}
+
+/**
+ * @brief Converts milliseconds to whole simulation ticks, rounding to nearest.
+ */
+int millisecondsToTicks(int ms) {
+    return (ms * TICKS_PER_SECOND + 500) / 1000;
+}
+
+// One side of a simulated versus match
+struct VersusPeer {
+    unique_ptr<Transport> socket; // the UDP socket, when not in process
+    unique_ptr<ImpairedTransport> link;
+    unique_ptr<RollbackSession> session;
+    unique_ptr<Bot> bot;
+    BotPlan plan;
+};
+
+/**
+ * @brief Plays two bots against each other, each through its own
+ * rollback session, over an impaired link, and prints one CSV row.
+ *
+ * The peers take turns on one thread against a virtual clock of
+ * simulation ticks, so the injected delay is exact and the run is as
+ * fast as the simulation. At the end both peers are run until they have
+ * each other's inputs for every tick, and their states are compared.
+ *
+ * @return false if the link could not be set up.
+ */
+bool playVersus(int latencyMs, int jitterMs, int lossPercent, int udpPort, const BotConfig& config, uint64_t seed, int seconds) {
+    LinkImpairment impairment;
+    impairment.delayTicks = millisecondsToTicks(latencyMs);
+    impairment.jitterTicks = millisecondsToTicks(jitterMs);
+    impairment.lossPercent = lossPercent;
+
+    LocalLink localLink;
+    VersusPeer peers[VERSUS_PLAYERS];
+    for (int i = 0; i < VERSUS_PLAYERS; i++) {
+        VersusPeer& peer = peers[i];
+        Transport* carrier = &localLink.end(i);
+        if (udpPort > 0) {
+            UdpTransport* socket = new UdpTransport();
+            peer.socket.reset(socket);
+            if (!socket->open(udpPort + i, "127.0.0.1", udpPort + 1 - i)) {
+                return false;
+            }
+            carrier = socket;
+        }
+        peer.link.reset(new ImpairedTransport(*carrier, impairment, mixBits(seed + i)));
+        peer.session.reset(new RollbackSession(i, seed, GameRules(), *peer.link));
+        peer.bot.reset(new Bot(config));
+    }
+
+    const uint64_t ticks = uint64_t(seconds) * TICKS_PER_SECOND;
+    // Enough time to finish under any delay and loss that lets a packet through
+    const uint64_t clockLimit = ticks * 100 + 100000;
+    uint64_t clock = 0;
+    auto done = [&] {
+        for (VersusPeer& peer : peers) {
+            if (peer.session->tick() < ticks || peer.session->remoteInputEnd() < ticks) {
+                return false;
+            }
+        }
+        return true;
+    };
+    for (; !done() && clock < clockLimit; clock++) {
+        for (VersusPeer& peer : peers) {
+            RollbackSession& session = *peer.session;
+            peer.link->setTick(clock);
+            session.poll();
+            if (session.tick() < ticks) {
+                // A stalled tick does not count as a press, so the bot's plan is kept as it was
+                BotPlan plan = peer.plan;
+                Input input = peer.bot->nextInput(session.state().players[session.localPlayer()], peer.plan);
+                if (!session.advance(input)) {
+                    peer.plan = plan;
+                }
+            } else {
+                session.sendInputs();
+            }
+        }
+    }
+    for (VersusPeer& peer : peers) {
+        peer.link->setTick(clock);
+        peer.session->poll();
+    }
+
+    RollbackStats total;
+    uint64_t dropped = 0;
+    for (VersusPeer& peer : peers) {
+        const RollbackStats& stats = peer.session->stats();
+        total.ticks += stats.ticks;
+        total.stalls += stats.stalls;
+        total.rollbacks += stats.rollbacks;
+        total.resimulatedTicks += stats.resimulatedTicks;
+        total.resimulateNs += stats.resimulateNs;
+        total.worstResimulateNs = max(total.worstResimulateNs, stats.worstResimulateNs);
+        total.worstRollbackTicks = max(total.worstRollbackTicks, stats.worstRollbackTicks);
+        total.packetsSent += stats.packetsSent;
+        dropped += peer.link->droppedCount();
+    }
+    const VersusState& first = peers[0].session->state();
+    bool synced = done() && first.checksum() == peers[1].session->state().checksum();
+    double gameSeconds = double(total.ticks) / VERSUS_PLAYERS / TICKS_PER_SECOND;
+    static const char* const RESULT_NAMES[] = { "first", "second", "draw" };
+    VersusResult result = first.result();
+
+    cout << latencyMs << "," << jitterMs << "," << lossPercent << "," << (udpPort > 0 ? "udp" : "local") << ","
+         << total.ticks / VERSUS_PLAYERS << "," << total.rollbacks << "," << fixed << setprecision(1)
+         << total.resimulatedTicks / VERSUS_PLAYERS / gameSeconds << ","
+         << (total.resimulateNs > 0 ? total.resimulatedTicks * 1e9 / total.resimulateNs : 0.0) << ","
+         << (total.rollbacks > 0 ? double(total.resimulatedTicks) / total.rollbacks : 0.0) << ","
+         << total.worstRollbackTicks << "," << setprecision(3) << total.worstResimulateNs / 1e6 << ","
+         << total.stalls << "," << total.packetsSent << "," << dropped << ","
+         << (result == VERSUS_PLAYING ? "none" : RESULT_NAMES[result]) << "," << (synced ? 1 : 0) << endl;
+    cout.unsetf(ios::floatfield);
+    return true;
+}
+
+/**
+ * @brief Reports the cost of rollback at each injected latency: how many
+ * ticks are simulated again per game second, how fast, and the longest
+ * single resimulation.
+ *
+ * The bots tap a button every other tick, the worst case for predicting
+ * the remote input, so nearly every packet triggers a rollback as long
+ * as the delay.
+ */
+int runVersus(int argc, char* args[]) {
+    vector<int> latencies = { 0, 25, 50, 100, 200 };
+    int jitter = 0;
+    int loss = 0;
+    int seconds = 60;
+    int udpPort = 0;
+    uint64_t seed = 1;
+    BotConfig config;
+    config.depth = 1;
+
+    for (int i = 0; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--latency") == 0 && hasValue) {
+            latencies = parseIntList(args[++i], 0);
+            if (latencies.empty()) {
+                printUsage();
+                return 1;
+            }
+        } else if (strcmp(args[i], "--jitter") == 0 && hasValue) {
+            jitter = atoi(args[++i]);
+        } else if (strcmp(args[i], "--loss") == 0 && hasValue) {
+            loss = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seconds") == 0 && hasValue) {
+            seconds = atoi(args[++i]);
+        } else if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            config.depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(args[++i], NULL, 10);
+        } else if (strcmp(args[i], "--udp") == 0 && hasValue) {
+            udpPort = atoi(args[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (jitter < 0 || loss < 0 || loss >= 100 || seconds <= 0 || config.depth <= 0 || udpPort < 0 || udpPort > 65534) {
+        printUsage();
+        return 1;
+    }
+
+    cout << "latency_ms,jitter_ms,loss_pct,transport,ticks,rollbacks,rollback_frames_per_sec,resim_ticks_per_sec,"
+         << "mean_rollback_ticks,worst_rollback_ticks,worst_resim_ms,stalls,packets,dropped,winner,in_sync" << endl;
+    for (int latency : latencies) {
+        if (!playVersus(latency, jitter, loss, udpPort, config, seed, seconds)) {
+            cout << "Failed to open UDP ports " << udpPort << " and " << udpPort + 1 << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Letter of each piece type, in PieceType order
+const char PIECE_LETTERS[] = "IJLOSTZ";
+
+/**
+ * @brief The board of a perft position: the bottom rows filled at
+ * random, about half their cells each and never all of them, so there
+ * are overhangs to tuck pieces under and slots to spin them into.
+ */
+Board perftBoard(uint64_t seed, int rows) {
+    Board board;
+    clearBoard(board);
+    uint64_t random = seed;
+    for (int y = BOARD_HEIGHT - rows; y < BOARD_HEIGHT; y++) {
+        int hole = int(mixBits(random += 0x9E3779B97F4A7C15ull) % BOARD_WIDTH);
+        uint64_t cells = mixBits(random += 0x9E3779B97F4A7C15ull);
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            if (x != hole && ((cells >> x) & 1) != 0) {
+                setCell(board, x, y, GARBAGE_COLOR);
+            }
+        }
+    }
+    return board;
+}
+
+/**
+ * @brief Counts placement sequences with perft() to each depth from a
+ * seeded position, once on one thread and once split across a pool at
+ * the root, and checks that both agree.
+ *
+ * The counts are an oracle for the move generator: any change to it or
+ * to the moves it follows that changes a count changes what the game
+ * lets a player reach.
+ */
+int runPerft(int argc, char* args[]) {
+    int depth = 3;
+    int rows = 8;
+    int threads = max(1, int(thread::hardware_concurrency()));
+    uint64_t seed = 1;
+    const char* letters = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(args[i], "--depth") == 0 && hasValue) {
+            depth = atoi(args[++i]);
+        } else if (strcmp(args[i], "--rows") == 0 && hasValue) {
+            rows = atoi(args[++i]);
+        } else if (strcmp(args[i], "--pieces") == 0 && hasValue) {
+            letters = args[++i];
+        } else if (strcmp(args[i], "--threads") == 0 && hasValue) {
+            threads = atoi(args[++i]);
+        } else if (strcmp(args[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(args[++i], NULL, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (letters != NULL) {
+        depth = int(strlen(letters));
+    }
+    if (depth <= 0 || rows < 0 || rows > BOARD_HEIGHT - 4 || threads <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    vector<int> pieces(depth);
+    for (int i = 0; i < depth; i++) {
+        if (letters != NULL) {
+            const char* letter = strchr(PIECE_LETTERS, toupper(letters[i]));
+            if (letter == NULL || *letter == '\0') {
+                cout << "Unknown piece " << letters[i] << "; pieces are " << PIECE_LETTERS << endl;
+                return 1;
+            }
+            pieces[i] = int(letter - PIECE_LETTERS);
+        } else {
+            pieces[i] = int(mixBits(seed * 0xD6E8FEB86659FD93ull + i + 1) % PIECE_COUNT);
+        }
+    }
+    Board board = perftBoard(seed, rows);
+
+    cout << "Pieces: ";
+    for (int type : pieces) {
+        cout << PIECE_LETTERS[type];
+    }
+    cout << endl;
+    for (int y = BOARD_HEIGHT - rows; y < BOARD_HEIGHT; y++) {
+        cout << "  ";
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            cout << (isCellFilled(board, x, y) ? '#' : '.');
+        }
+        cout << endl;
+    }
+    Tetromino reachable[MAX_REACHABLE_PLACEMENTS];
+    Tetromino dropped[MAX_PLACEMENTS];
+    int reachableCount = findReachablePlacements(board, pieces[0], reachable);
+    int droppedCount = findPlacements(board, pieces[0], dropped);
+    vector<char> found(PIECE_STATE_COUNT, false);
+    int distinctDropped = 0;
+    for (int i = 0; i < droppedCount; i++) {
+        int index = placementIndex(dropped[i]);
+        distinctDropped += found[index] ? 0 : 1;
+        found[index] = true;
+    }
+    cout << "First piece: " << reachableCount << " reachable placements, " << distinctDropped
+         << " by rotating then dropping" << endl;
+    cout << endl;
+
+    WorkStealingPool pool(threads);
+    bool agree = true;
+    cout << "depth,nodes,single_ms,single_nodes_per_sec,threads,split_ms,split_nodes_per_sec,speedup,match" << endl;
+    for (int d = 1; d <= depth; d++) {
+        auto start = chrono::steady_clock::now();
+        uint64_t nodes = perft(board, pieces.data(), d);
+        double singleSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        start = chrono::steady_clock::now();
+        uint64_t splitNodes = perftSplit(board, pieces.data(), d, pool);
+        double splitSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        bool match = nodes == splitNodes;
+        agree = agree && match;
+        cout << d << "," << nodes << "," << fixed << setprecision(3) << singleSeconds * 1000 << ","
+             << setprecision(0) << nodes / max(singleSeconds, 1e-9) << "," << threads << ","
+             << setprecision(3) << splitSeconds * 1000 << "," << setprecision(0) << splitNodes / max(splitSeconds, 1e-9) << ","
+             << setprecision(2) << singleSeconds / max(splitSeconds, 1e-9) << "," << (match ? 1 : 0) << endl;
+        cout.unsetf(ios::floatfield);
+    }
+    return agree ? 0 : 1;
+}
+
+/**
+ * @brief Entry point of the headless simulator. Runs game logic from
+ * tetris_core without opening a window.
+ */
+int main(int argc, char* args[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    if (strcmp(args[1], "autoplay") == 0) {
+        return runAutoplay(argc - 2, args + 2);
+    }
+    if (strcmp(args[1], "batch") == 0) {
+        return runBatch(argc - 2, args + 2);
+    }
+    if (strcmp(args[1], "replay") == 0) {
+        return runReplay(argc - 2, args + 2);
+    }
+    if (strcmp(args[1], "arena") == 0) {
+        return runArena(argc - 2, args + 2);
+    }
+    if (strcmp(args[1], "versus") == 0) {
+        return runVersus(argc - 2, args + 2);
+    }
+    if (strcmp(args[1], "perft") == 0) {
+        return runPerft(argc - 2, args + 2);
+    }
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,257 @@
+#include "text.h"
+
+#ifdef TETRIS_EMBEDDED_FONT
+#include "font_atlas.h"
+#endif
+
+#include <iostream>
+
+using namespace std;
+
+
+TextRenderer::TextRenderer(SDL_Renderer* renderer, TTF_Font* font)
+    : renderer(renderer), font(font) {
+    GlyphSheet sheet;
+    if (!rasterizeGlyphs(font, sheet) || !uploadAtlas(sheet)) {
+        cout << "Failed to build glyph atlas! SDL_Error: " << SDL_GetError() << endl;
+    }
+}
+
+/**
+ * @brief Draws from the atlas built into the binary, without a font.
+ *
+ * The atlas is stored with each run of transparent pixels as a 0 byte
+ * and the run length, and is expanded here.
+ */
+TextRenderer::TextRenderer(SDL_Renderer* renderer)
+    : renderer(renderer) {
+#ifdef TETRIS_EMBEDDED_FONT
+    static_assert(EMBEDDED_ATLAS_WIDTH == ATLAS_WIDTH && EMBEDDED_FONT_SIZE == FONT_SIZE,
+                  "The embedded atlas was generated with other settings");
+    GlyphSheet sheet;
+    sheet.lineHeight = EMBEDDED_LINE_HEIGHT;
+    sheet.atlasHeight = EMBEDDED_ATLAS_HEIGHT;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        const int16_t* glyph = EMBEDDED_GLYPHS[i];
+        sheet.sources[i] = { glyph[0], glyph[1], glyph[2], glyph[3] };
+        sheet.advances[i] = glyph[4];
+    }
+    sheet.alpha.reserve(size_t(ATLAS_WIDTH) * EMBEDDED_ATLAS_HEIGHT);
+    for (size_t i = 0; i < sizeof(EMBEDDED_ATLAS_RLE); i++) {
+        if (EMBEDDED_ATLAS_RLE[i] == 0) {
+            sheet.alpha.insert(sheet.alpha.end(), EMBEDDED_ATLAS_RLE[++i], 0);
+        } else {
+            sheet.alpha.push_back(EMBEDDED_ATLAS_RLE[i]);
+        }
+    }
+    if (sheet.alpha.size() == size_t(ATLAS_WIDTH) * EMBEDDED_ATLAS_HEIGHT && uploadAtlas(sheet)) {
+        return;
+    }
+#endif
+    cout << "Failed to load the embedded glyph atlas! SDL_Error: " << SDL_GetError() << endl;
+}
+
+TextRenderer::~TextRenderer() {
+    clearCache();
+    if (atlas != NULL) {
+        SDL_DestroyTexture(atlas);
+    }
+}
+
+/**
+ * @brief Whether the build compiled a glyph atlas into the binary.
+ */
+bool hasEmbeddedFont() {
+#ifdef TETRIS_EMBEDDED_FONT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Rasterizes every printable glyph of a font and packs them into
+ * rows of the atlas width.
+ *
+ * The game calls this when it loads a font at runtime, and font_atlas_gen
+ * calls it at build time to make the embedded atlas, so both look the same.
+ *
+ * @param font The font.
+ * @param sheet Receives the glyph layout and the atlas coverage.
+ * @return false if the font has no height to lay glyphs out by.
+ */
+bool rasterizeGlyphs(TTF_Font* font, GlyphSheet& sheet) {
+    SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Surface* surfaces[GLYPH_COUNT];
+    int height = TTF_FontHeight(font);
+    sheet.lineHeight = height;
+
+    // Lay the glyphs out left to right in rows of the atlas width
+    int penX = 0;
+    int penY = 0;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        Uint16 ch = Uint16(FIRST_GLYPH + i);
+        int advance = 0;
+        TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &advance);
+        SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, ch, white);
+        // Bytes in R, G, B, A order whatever the platform, so alpha is every fourth
+        surfaces[i] = rendered != NULL ? SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_RGBA32, 0) : NULL;
+        SDL_FreeSurface(rendered);
+        int w = surfaces[i] != NULL ? surfaces[i]->w : 0;
+        int h = surfaces[i] != NULL ? surfaces[i]->h : 0;
+        if (penX + w > ATLAS_WIDTH) {
+            penX = 0;
+            penY += height + 1;
+        }
+        sheet.sources[i] = { penX, penY, w, h };
+        sheet.advances[i] = advance;
+        penX += w + 1;
+    }
+    sheet.atlasHeight = penY + height;
+
+    sheet.alpha.assign(size_t(ATLAS_WIDTH) * sheet.atlasHeight, 0);
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        SDL_Surface* surface = surfaces[i];
+        if (surface == NULL) {
+            continue;
+        }
+        const SDL_Rect& dst = sheet.sources[i];
+        for (int y = 0; y < surface->h && dst.y + y < sheet.atlasHeight; y++) {
+            const uint8_t* row = static_cast<const uint8_t*>(surface->pixels) + y * surface->pitch;
+            for (int x = 0; x < surface->w; x++) {
+                sheet.alpha[size_t(dst.y + y) * ATLAS_WIDTH + dst.x + x] = row[x * 4 + 3];
+            }
+        }
+        SDL_FreeSurface(surface);
+    }
+    return height > 0;
+}
+
+/**
+ * @brief Creates the atlas texture from a glyph sheet.
+ *
+ * @return true if the atlas texture was created.
+ */
+bool TextRenderer::uploadAtlas(const GlyphSheet& sheet) {
+    height = sheet.lineHeight;
+    atlasHeight = sheet.atlasHeight;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        glyphs[i].source = sheet.sources[i];
+        glyphs[i].advance = sheet.advances[i];
+    }
+
+    SDL_Surface* image = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, atlasHeight, 32, SDL_PIXELFORMAT_RGBA32);
+    if (image == NULL) {
+        return false;
+    }
+    for (int y = 0; y < atlasHeight; y++) {
+        uint8_t* row = static_cast<uint8_t*>(image->pixels) + y * image->pitch;
+        for (int x = 0; x < ATLAS_WIDTH; x++) {
+            uint8_t* pixel = row + x * 4;
+            pixel[0] = pixel[1] = pixel[2] = 255;
+            pixel[3] = sheet.alpha[size_t(y) * ATLAS_WIDTH + x];
+        }
+    }
+    atlas = SDL_CreateTextureFromSurface(renderer, image);
+    SDL_FreeSurface(image);
+    if (atlas == NULL) {
+        return false;
+    }
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+/**
+ * @brief Draws a string from the glyph atlas in a single batched draw call.
+ *
+ * @param text The text to draw. Characters outside printable ASCII draw as '?'.
+ * @param x The x-coordinate of the text.
+ * @param y The y-coordinate of the text.
+ * @param color The color of the text.
+ * @return int The number of vertices submitted.
+ */
+int TextRenderer::drawString(const std::string& text, int x, int y, SDL_Color color) {
+    if (atlas == NULL || text.empty()) {
+        return 0;
+    }
+
+    vertices.clear();
+    indices.clear();
+    float u = 1.0f / ATLAS_WIDTH;
+    float v = 1.0f / atlasHeight;
+    float penX = float(x);
+    for (char c : text) {
+        int index = (c >= FIRST_GLYPH && c <= LAST_GLYPH) ? c - FIRST_GLYPH : '?' - FIRST_GLYPH;
+        const Glyph& glyph = glyphs[index];
+        const SDL_Rect& src = glyph.source;
+        if (src.w > 0) {
+            int base = int(vertices.size());
+            float left = penX, top = float(y), right = penX + src.w, bottom = float(y + src.h);
+            vertices.push_back({ { left, top }, color, { src.x * u, src.y * v } });
+            vertices.push_back({ { right, top }, color, { (src.x + src.w) * u, src.y * v } });
+            vertices.push_back({ { right, bottom }, color, { (src.x + src.w) * u, (src.y + src.h) * v } });
+            vertices.push_back({ { left, bottom }, color, { src.x * u, (src.y + src.h) * v } });
+            int quad[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+        penX += glyph.advance;
+    }
+
+    SDL_RenderGeometry(renderer, atlas, vertices.data(), int(vertices.size()), indices.data(), int(indices.size()));
+    return int(vertices.size());
+}
+
+/**
+ * @brief Draws a string from a texture cached for its content and color.
+ *
+ * The texture is rendered the first time a string is drawn and reused
+ * afterwards. Meant for labels that change rarely, such as "Game Over".
+ *
+ * @param text The text to draw.
+ * @param x The x-coordinate of the text.
+ * @param y The y-coordinate of the text.
+ * @param color The color of the text.
+ */
+void TextRenderer::drawCached(const std::string& text, int x, int y, SDL_Color color) {
+    if (text.empty()) {
+        return;
+    }
+    if (font == NULL) {
+        drawString(text, x, y, color);
+        return;
+    }
+
+    std::string key = text;
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&color), sizeof(color));
+
+    auto found = cache.find(key);
+    if (found == cache.end()) {
+        if (cache.size() >= TEXT_CACHE_LIMIT) {
+            clearCache();
+        }
+        SDL_Surface* surface = TTF_RenderText_Solid(font, text.c_str(), color);
+        if (surface == NULL) {
+            return;
+        }
+        CachedText entry = { SDL_CreateTextureFromSurface(renderer, surface), surface->w, surface->h };
+        SDL_FreeSurface(surface);
+        if (entry.texture == NULL) {
+            return;
+        }
+        found = cache.emplace(key, entry).first;
+    }
+
+    SDL_Rect dstRect = { x, y, found->second.w, found->second.h };
+    SDL_RenderCopy(renderer, found->second.texture, NULL, &dstRect);
+}
+
+/**
+ * @brief Destroys every cached string texture.
+ */
+void TextRenderer::clearCache() {
+    for (auto& entry : cache) {
+        SDL_DestroyTexture(entry.second.texture);
+    }
+    cache.clear();
+}
@@ -0,0 +1,81 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const int FIRST_GLYPH = 32;  // space
+const int LAST_GLYPH = 126;  // tilde
+const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+const int ATLAS_WIDTH = 512;
+const int TEXT_CACHE_LIMIT = 64;
+const int FONT_SIZE = 16; // point size of the HUD font, and of the embedded atlas
+
+/**
+ * @brief The printable ASCII glyphs of a font, rasterized and packed into
+ * one image. Only coverage is kept: the atlas is white with this alpha.
+ */
+struct GlyphSheet {
+    int lineHeight = 0;
+    int atlasHeight = 0;
+    SDL_Rect sources[GLYPH_COUNT]; // location of each glyph in the atlas
+    int advances[GLYPH_COUNT];
+    std::vector<uint8_t> alpha;    // ATLAS_WIDTH * atlasHeight, row by row
+};
+
+bool rasterizeGlyphs(TTF_Font* font, GlyphSheet& sheet);
+bool hasEmbeddedFont();
+
+/**
+ * @brief Draws text without creating surfaces or textures per frame.
+ *
+ * The printable ASCII glyphs are rasterized once into a single atlas
+ * texture; drawString() emits one quad per character and submits the
+ * whole string with one SDL_RenderGeometry call. Strings that rarely
+ * change can instead use drawCached(), which keeps a texture per distinct
+ * string and color.
+ */
+class TextRenderer {
+public:
+    TextRenderer(SDL_Renderer* renderer, TTF_Font* font);
+    explicit TextRenderer(SDL_Renderer* renderer);
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    bool isValid() const { return atlas != NULL; }
+    int lineHeight() const { return height; }
+
+    int drawString(const std::string& text, int x, int y, SDL_Color color);
+    void drawCached(const std::string& text, int x, int y, SDL_Color color);
+    void clearCache();
+
+private:
+    struct Glyph {
+        SDL_Rect source; // location in the atlas
+        int advance;
+    };
+    struct CachedText {
+        SDL_Texture* texture;
+        int w, h;
+    };
+
+    bool uploadAtlas(const GlyphSheet& sheet);
+
+    SDL_Renderer* renderer;
+    TTF_Font* font = NULL;
+    SDL_Texture* atlas = NULL;
+    int atlasHeight = 0;
+    int height = 0;
+    Glyph glyphs[GLYPH_COUNT];
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::unordered_map<std::string, CachedText> cache;
+};
+
+#endif // TEXT_H
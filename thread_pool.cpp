@@ -0,0 +1,127 @@
+#include "thread_pool.h"
+
+// Which pool and deque the calling thread owns. Threads outside the pool
+// share deque 0.
+static thread_local const WorkStealingPool* currentPool = nullptr;
+static thread_local int currentIndex = 0;
+
+
+WorkStealingPool::WorkStealingPool(int threadCount) {
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+    for (int i = 0; i < threadCount; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Queues a task on the calling thread's deque.
+ *
+ * @param group The group the task belongs to.
+ * @param task The work to run.
+ */
+void WorkStealingPool::submit(TaskGroup& group, Task task) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    Queue& queue = *queues[currentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Entry{ &group, std::move(task) });
+    }
+    queuedTasks.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in workerLoop so a wakeup is never lost
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+/**
+ * @brief Runs tasks until every task in the group has finished.
+ *
+ * @param group The group to wait for.
+ */
+void WorkStealingPool::wait(TaskGroup& group) {
+    int index = currentQueue();
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (!runOne(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+int WorkStealingPool::currentQueue() const {
+    return currentPool == this ? currentIndex : 0;
+}
+
+bool WorkStealingPool::popLocal(int index, Entry& entry) {
+    Queue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    entry = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, Entry& entry) {
+    int count = int(queues.size());
+    for (int i = 1; i < count; i++) {
+        Queue& queue = *queues[(thief + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            entry = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Runs one task from the thread's own deque, or stolen from another.
+ *
+ * @param index The deque owned by the calling thread.
+ * @return true if a task was run.
+ */
+bool WorkStealingPool::runOne(int index) {
+    Entry entry;
+    if (!popLocal(index, entry) && !steal(index, entry)) {
+        return false;
+    }
+    queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    entry.task();
+    entry.group->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    currentPool = this;
+    currentIndex = index;
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queuedTasks.load(std::memory_order_acquire) > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Counts the outstanding tasks of one batch of work.
+ *
+ * Tasks may submit more tasks to the same group; wait() returns once all
+ * of them have run.
+ */
+struct TaskGroup {
+    std::atomic<int> pending{0};
+};
+
+/**
+ * @brief Thread pool with one task deque per thread and work stealing.
+ *
+ * A thread pushes and pops tasks at the back of its own deque, so nested
+ * work stays hot in its cache, and idle threads steal from the front of
+ * other deques. The thread calling wait() takes part in the work, so a
+ * pool of N threads starts N - 1 workers.
+ */
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    explicit WorkStealingPool(int threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int threadCount() const { return int(queues.size()); }
+    uint64_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+
+    void submit(TaskGroup& group, Task task);
+    void wait(TaskGroup& group);
+
+private:
+    struct Entry {
+        TaskGroup* group;
+        Task task;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Entry> tasks;
+    };
+
+    int currentQueue() const;
+    bool popLocal(int index, Entry& entry);
+    bool steal(int thief, Entry& entry);
+    bool runOne(int index);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queuedTasks{0};
+    std::atomic<uint64_t> steals{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
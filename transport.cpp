@@ -0,0 +1,197 @@
+#include "transport.h"
+#include "board.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+typedef SOCKET SocketHandle;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#endif
+
+using namespace std;
+
+
+/**
+ * @brief Appends a datagram.
+ *
+ * @return false if the queue was full or the datagram too big, and it was dropped.
+ */
+bool DatagramQueue::push(const uint8_t* data, int size) {
+    if (count == LINK_QUEUE_SIZE || size > MAX_PACKET_SIZE) {
+        return false;
+    }
+    Datagram& slot = slots[(head + count) % LINK_QUEUE_SIZE];
+    slot.size = size;
+    memcpy(slot.data, data, size);
+    count++;
+    return true;
+}
+
+void DatagramQueue::pop() {
+    head = (head + 1) % LINK_QUEUE_SIZE;
+    count--;
+}
+
+LocalLink::LocalLink() {
+    ends[0].peer = &ends[1];
+    ends[1].peer = &ends[0];
+}
+
+void LocalLink::End::send(const uint8_t* data, int size) {
+    peer->inbox.push(data, size);
+}
+
+int LocalLink::End::receive(uint8_t* buffer, int capacity) {
+    Datagram* datagram = inbox.front();
+    if (datagram == NULL) {
+        return 0;
+    }
+    int size = min(datagram->size, capacity);
+    memcpy(buffer, datagram->data, size);
+    inbox.pop();
+    return size;
+}
+
+
+UdpTransport::~UdpTransport() {
+    if (socketHandle != -1) {
+#ifdef _WIN32
+        closesocket(SocketHandle(socketHandle));
+        WSACleanup();
+#else
+        close(int(socketHandle));
+#endif
+    }
+}
+
+/**
+ * @brief Binds a UDP socket to a local port and sets where sends go.
+ *
+ * @param localPort The port to receive on.
+ * @param remoteHost The peer's IPv4 address, such as 127.0.0.1.
+ * @param remotePort The peer's port.
+ * @return true if the socket is ready.
+ */
+bool UdpTransport::open(int localPort, const char* remoteHost, int remotePort) {
+    static_assert(sizeof(remoteAddress) >= sizeof(sockaddr_in), "remoteAddress holds a sockaddr_in");
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        LOG_ERROR("WSAStartup failed");
+        return false;
+    }
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET) {
+        WSACleanup();
+        LOG_ERROR("Could not create a UDP socket");
+        return false;
+    }
+    u_long nonBlocking = 1;
+    ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0) {
+        LOG_ERROR("Could not create a UDP socket");
+        return false;
+    }
+    fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    socketHandle = intptr_t(handle);
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(uint16_t(localPort));
+    if (bind(handle, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        LOG_ERROR("Could not bind UDP port %d", localPort);
+        return false;
+    }
+
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(uint16_t(remotePort));
+    if (inet_pton(AF_INET, remoteHost, &remote.sin_addr) != 1) {
+        LOG_ERROR("Not an IPv4 address: %s", remoteHost);
+        return false;
+    }
+    memcpy(remoteAddress, &remote, sizeof(remote));
+    return true;
+}
+
+void UdpTransport::send(const uint8_t* data, int size) {
+    sendto(SocketHandle(socketHandle), reinterpret_cast<const char*>(data), size, 0,
+           reinterpret_cast<const sockaddr*>(remoteAddress), sizeof(sockaddr_in));
+}
+
+int UdpTransport::receive(uint8_t* buffer, int capacity) {
+    sockaddr_in from;
+    socklen_t fromSize = sizeof(from);
+    int size = int(recvfrom(SocketHandle(socketHandle), reinterpret_cast<char*>(buffer), capacity, 0,
+                            reinterpret_cast<sockaddr*>(&from), &fromSize));
+    // Nothing waiting, or an error such as a refused port on Windows
+    return max(size, 0);
+}
+
+
+/**
+ * @brief Impairs the datagrams sent through another transport.
+ *
+ * @param inner The transport that carries what is not dropped.
+ * @param impairment The delay, jitter and loss to inject.
+ * @param seed Seeds the jitter and the losses.
+ */
+ImpairedTransport::ImpairedTransport(Transport& inner, const LinkImpairment& impairment, uint64_t seed)
+    : inner(inner), impairment(impairment), rngState(seed) {
+}
+
+/**
+ * @brief Moves the clock on and passes every datagram now due to the
+ * inner transport.
+ */
+void ImpairedTransport::setTick(uint64_t tick) {
+    now = tick;
+    // Datagrams due together go out in the order they were sent
+    int kept = 0;
+    for (int i = 0; i < heldCount; i++) {
+        if (held[i].due <= now) {
+            inner.send(held[i].data, held[i].size);
+        } else {
+            if (kept != i) {
+                held[kept] = held[i];
+            }
+            kept++;
+        }
+    }
+    heldCount = kept;
+}
+
+void ImpairedTransport::send(const uint8_t* data, int size) {
+    uint64_t random = mixBits(rngState += 0x9E3779B97F4A7C15ull);
+    if (int(random % 100) < impairment.lossPercent || heldCount == LINK_QUEUE_SIZE || size > MAX_PACKET_SIZE) {
+        dropped++;
+        return;
+    }
+    int jitter = impairment.jitterTicks > 0 ? int((random >> 32) % uint64_t(impairment.jitterTicks + 1)) : 0;
+    Datagram& datagram = held[heldCount++];
+    datagram.due = now + impairment.delayTicks + jitter;
+    datagram.size = size;
+    memcpy(datagram.data, data, size);
+    if (datagram.due <= now) {
+        setTick(now);
+    }
+}
+
+int ImpairedTransport::receive(uint8_t* buffer, int capacity) {
+    return inner.receive(buffer, capacity);
+}
@@ -0,0 +1,125 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Largest datagram any transport carries
+const int MAX_PACKET_SIZE = 128;
+// Datagrams a link holds in flight in each direction; more are dropped
+const int LINK_QUEUE_SIZE = 256;
+
+/**
+ * @brief Unreliable, unordered datagrams to one peer, like UDP.
+ *
+ * Neither call blocks. A send may be lost.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual void send(const uint8_t* data, int size) = 0;
+    // Copies the next waiting datagram into buffer; returns its size, or 0 if none waits
+    virtual int receive(uint8_t* buffer, int capacity) = 0;
+};
+
+struct Datagram {
+    uint64_t due; // for an impaired link, the tick the datagram is delivered on
+    int size;
+    uint8_t data[MAX_PACKET_SIZE];
+};
+
+/**
+ * @brief A fixed ring of datagrams; push drops the datagram when full.
+ */
+struct DatagramQueue {
+    Datagram slots[LINK_QUEUE_SIZE];
+    int head = 0;
+    int count = 0;
+
+    bool push(const uint8_t* data, int size);
+    Datagram* front() { return count > 0 ? &slots[head] : NULL; }
+    void pop();
+};
+
+/**
+ * @brief Two connected transports in one process: what one end sends,
+ * the other receives, instantly and in order.
+ */
+class LocalLink {
+public:
+    LocalLink();
+
+    LocalLink(const LocalLink&) = delete;
+    LocalLink& operator=(const LocalLink&) = delete;
+
+    Transport& end(int index) { return ends[index]; }
+
+private:
+    class End : public Transport {
+    public:
+        DatagramQueue inbox;
+        End* peer = NULL;
+
+        void send(const uint8_t* data, int size) override;
+        int receive(uint8_t* buffer, int capacity) override;
+    };
+
+    End ends[2];
+};
+
+/**
+ * @brief A UDP socket sending to one address, non-blocking.
+ */
+class UdpTransport : public Transport {
+public:
+    UdpTransport() {}
+    ~UdpTransport();
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    bool open(int localPort, const char* remoteHost, int remotePort);
+    void send(const uint8_t* data, int size) override;
+    int receive(uint8_t* buffer, int capacity) override;
+
+private:
+    intptr_t socketHandle = -1;
+    uint8_t remoteAddress[16] = {}; // a sockaddr_in
+};
+
+// Injected network conditions, in simulation ticks
+struct LinkImpairment {
+    int delayTicks = 0;  // one-way delay
+    int jitterTicks = 0; // up to this much more, at random, which reorders datagrams
+    int lossPercent = 0; // chance of dropping each datagram
+};
+
+/**
+ * @brief Wraps a transport and delays, reorders and drops what is sent
+ * through it, on a clock of simulation ticks set by setTick().
+ *
+ * Held datagrams live in a fixed queue, so impairing a link allocates
+ * nothing after construction.
+ */
+class ImpairedTransport : public Transport {
+public:
+    ImpairedTransport(Transport& inner, const LinkImpairment& impairment, uint64_t seed);
+
+    void setTick(uint64_t tick);
+    void send(const uint8_t* data, int size) override;
+    int receive(uint8_t* buffer, int capacity) override;
+
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    Transport& inner;
+    LinkImpairment impairment;
+    uint64_t rngState;
+    uint64_t now = 0;
+    uint64_t dropped = 0;
+    Datagram held[LINK_QUEUE_SIZE];
+    int heldCount = 0;
+};
+
+#endif // TRANSPORT_H
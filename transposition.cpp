@@ -0,0 +1,129 @@
+#include "transposition.h"
+#include "board.h"
+
+#include <cstring>
+
+// Layout of Entry::meta
+const int META_DEPTH_SHIFT = 0;
+const int META_BEST_SHIFT = 8;
+const int META_GENERATION_SHIFT = 16;
+const int META_NODES_SHIFT = 24;
+const uint64_t META_NODES_MAX = (uint64_t(1) << (64 - META_NODES_SHIFT)) - 1;
+
+static uint64_t doubleBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/**
+ * @brief Allocates an empty table.
+ *
+ * @param megabytes Memory for the entries; rounded down to a power of two
+ * entries, with at least one entry.
+ * @param policy Which entries a store may overwrite.
+ */
+TranspositionTable::TranspositionTable(size_t megabytes, ReplacementPolicy policy)
+    : policy(policy) {
+    size_t count = megabytes * 1024 * 1024 / sizeof(Entry);
+    size_t entryCount = 1;
+    while (entryCount * 2 <= count) {
+        entryCount *= 2;
+    }
+    entries.reset(new Entry[entryCount]);
+    mask = entryCount - 1;
+    clear();
+}
+
+/**
+ * @brief Looks up a key.
+ *
+ * Safe to call while other threads store.
+ *
+ * @param key The entry key, from searchKey().
+ * @param hit Receives the cached result on a hit.
+ * @return true if the key was found.
+ */
+bool TranspositionTable::probe(uint64_t key, TableHit& hit) const {
+    const Entry& entry = entries[key & mask];
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    uint64_t value = entry.value.load(std::memory_order_relaxed);
+    uint64_t meta = entry.meta.load(std::memory_order_relaxed);
+    if ((check ^ value ^ meta) != key || meta == 0) {
+        return false;
+    }
+    hit.value = bitsDouble(value);
+    hit.best = int((meta >> META_BEST_SHIFT) & 0xFF);
+    hit.nodes = meta >> META_NODES_SHIFT;
+    return true;
+}
+
+/**
+ * @brief Stores a search result, unless the replacement policy keeps the
+ * entry already in its slot.
+ *
+ * Safe to call from several threads at once; a store racing another to
+ * the same slot may be lost, which only costs a later miss.
+ *
+ * @param key The entry key, from searchKey().
+ * @param depth Pieces searched to compute the value, at least 1.
+ * @param value The search value.
+ * @param best Index of the best placement.
+ * @param nodes Nodes searched to compute the value.
+ */
+void TranspositionTable::store(uint64_t key, int depth, double value, int best, uint64_t nodes) {
+    Entry& entry = entries[key & mask];
+    if (policy == REPLACE_DEPTH_PREFERRED) {
+        uint64_t old = entry.meta.load(std::memory_order_relaxed);
+        int oldDepth = int((old >> META_DEPTH_SHIFT) & 0xFF);
+        uint8_t oldGeneration = uint8_t(old >> META_GENERATION_SHIFT);
+        if (old != 0 && oldGeneration == generation && oldDepth > depth) {
+            return;
+        }
+    }
+
+    uint64_t meta = uint64_t(depth & 0xFF) << META_DEPTH_SHIFT
+        | uint64_t(best & 0xFF) << META_BEST_SHIFT
+        | uint64_t(generation) << META_GENERATION_SHIFT
+        | (nodes < META_NODES_MAX ? nodes : META_NODES_MAX) << META_NODES_SHIFT;
+    uint64_t bits = doubleBits(value);
+    entry.check.store(key ^ bits ^ meta, std::memory_order_relaxed);
+    entry.value.store(bits, std::memory_order_relaxed);
+    entry.meta.store(meta, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Starts a new search: entries stored before it become stale and
+ * any policy may replace them.
+ */
+void TranspositionTable::newSearch() {
+    generation++;
+}
+
+/**
+ * @brief Empties every entry. Not safe while other threads use the table.
+ */
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= mask; i++) {
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].value.store(0, std::memory_order_relaxed);
+        entries[i].meta.store(0, std::memory_order_relaxed);
+    }
+    generation = 0;
+}
+
+/**
+ * @brief Mixes the search depth and the lines cleared so far into a
+ * position hash. Both change a search value, so results for different
+ * depths or line counts never share an entry.
+ */
+uint64_t searchKey(uint64_t position, int depth, int lines) {
+    return mixBits(position ^ (uint64_t(depth) << 48) ^ uint64_t(lines));
+}
@@ -0,0 +1,66 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Which entry a store may overwrite
+enum ReplacementPolicy {
+    REPLACE_DEPTH_PREFERRED, // keep deeper results from the current search; stale ones always go
+    REPLACE_ALWAYS           // the newest result always wins
+};
+
+// A result found in the table
+struct TableHit {
+    double value;
+    int best;       // index of the best placement, in findPlacements order
+    uint64_t nodes; // nodes it took to compute the value
+};
+
+/**
+ * @brief Fixed-size, lock-free cache of search results keyed by a
+ * 64-bit position hash.
+ *
+ * Entries are three words written and read without locks. The first word
+ * holds the key XORed with the other two, so an entry torn by a
+ * concurrent store fails the key check and reads as a miss instead of
+ * returning another position's value. The size is rounded down to a
+ * power of two entries so the slot is a mask of the key.
+ */
+class TranspositionTable {
+public:
+    TranspositionTable(size_t megabytes, ReplacementPolicy policy);
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    bool probe(uint64_t key, TableHit& hit) const;
+    void store(uint64_t key, int depth, double value, int best, uint64_t nodes);
+    void newSearch();
+    void clear();
+
+    size_t entryCount() const { return mask + 1; }
+    size_t bytes() const { return entryCount() * sizeof(Entry); }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check; // key ^ value ^ meta
+        std::atomic<uint64_t> value; // bits of the double
+        std::atomic<uint64_t> meta;  // depth, best, generation and node count
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+    ReplacementPolicy policy;
+    uint8_t generation = 0;
+};
+
+/**
+ * @brief Combines a position hash with the search parameters that change
+ * its value, giving the key of one table entry.
+ */
+uint64_t searchKey(uint64_t position, int depth, int lines);
+
+#endif // TRANSPOSITION_H
@@ -0,0 +1,80 @@
+#include "versus.h"
+
+#include <type_traits>
+
+using namespace std;
+
+static_assert(is_trivially_copyable<VersusState>::value, "Rollback snapshots are plain copies");
+
+
+/**
+ * @brief Starts a new match.
+ *
+ * @param seed Seeds both players' pieces and garbage.
+ * @param rules The rules both players play by.
+ */
+void VersusState::reset(uint64_t seed, const GameRules& rules) {
+    for (GameState& player : players) {
+        player.rules = rules;
+        player.reset(seed);
+    }
+}
+
+/**
+ * @brief Advances both games one tick and exchanges the garbage sent.
+ *
+ * @param first The first player's buttons.
+ * @param second The second player's buttons.
+ */
+void VersusState::step(Input first, Input second) {
+    if (result() != VERSUS_PLAYING) {
+        return;
+    }
+    players[0].step(first);
+    players[1].step(second);
+    for (int i = 0; i < VERSUS_PLAYERS; i++) {
+        GameState& target = players[1 - i];
+        target.incomingGarbage += players[i].outgoingGarbage;
+        players[i].outgoingGarbage = 0;
+    }
+}
+
+/**
+ * @brief The winner once a player has topped out; both topping out on the
+ * same tick is a draw.
+ */
+VersusResult VersusState::result() const {
+    bool firstOut = players[0].gameOver;
+    bool secondOut = players[1].gameOver;
+    if (firstOut && secondOut) {
+        return VERSUS_DRAW;
+    }
+    if (firstOut) {
+        return VERSUS_SECOND_WINS;
+    }
+    if (secondOut) {
+        return VERSUS_FIRST_WINS;
+    }
+    return VERSUS_PLAYING;
+}
+
+/**
+ * @brief Hash of everything that decides how the match goes on, to check
+ * that two peers simulated the same match.
+ */
+uint64_t VersusState::checksum() const {
+    uint64_t hash = 0;
+    for (const GameState& player : players) {
+        uint64_t values[] = {
+            player.positionHash(), player.tick, player.rngState, player.garbageRngState,
+            uint64_t(player.current.x) << 32 | uint32_t(player.current.y),
+            uint64_t(player.current.rotation) << 32 | uint32_t(player.score),
+            uint64_t(player.incomingGarbage) << 32 | uint32_t(player.pieceCount),
+            player.pendingClear, uint64_t(player.gameOver)
+        };
+        for (uint64_t value : values) {
+            hash = mixBits(hash ^ value);
+        }
+    }
+    return hash;
+}
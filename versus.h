@@ -0,0 +1,35 @@
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include <cstdint>
+#include "game.h"
+
+const int VERSUS_PLAYERS = 2;
+
+// Outcome of a versus match
+enum VersusResult {
+    VERSUS_PLAYING = -1,
+    VERSUS_FIRST_WINS = 0,
+    VERSUS_SECOND_WINS = 1,
+    VERSUS_DRAW = 2
+};
+
+/**
+ * @brief Two games played against each other with garbage.
+ *
+ * Both players get the same piece sequence. After each tick the garbage
+ * a player sent is queued on the other player. The match is as flat as
+ * GameState, so assigning it takes a complete snapshot in constant time
+ * with no allocation, which is what rollback relies on.
+ */
+struct VersusState {
+    GameState players[VERSUS_PLAYERS];
+
+    void reset(uint64_t seed, const GameRules& rules);
+    void step(Input first, Input second);
+
+    VersusResult result() const;
+    uint64_t checksum() const;
+};
+
+#endif // VERSUS_H